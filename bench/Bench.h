@@ -0,0 +1,148 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include "Designs.h"
+
+// repeats each benchmark until it has run for min_time seconds and at
+// least min_reps times, and writes the minimum, median and mean wall
+// time of a repetition as one record: a JSON object per line, or a row
+// of CSV. the work of a repetition, e.g. the ADMM iterations of a path
+// or the bytes read by a kernel, is reported with its unit so that
+// rates can be compared across designs
+namespace Bench {
+
+
+struct Options
+{
+    std::vector<std::string> designs;
+    std::vector<std::string> suites;
+    std::string filter;          // only benchmarks whose suite/name contains it
+    std::string format;          // "json" or "csv"
+    int n;
+    int p;
+    double density;
+    int nlambda;
+    double lambda_min_ratio;     // smallest lambda of the paths / lambda_zero
+    int maxit;                   // of each lambda
+    int threads;
+    double min_time;
+    int min_reps;
+    unsigned int seed;
+
+    Options() :
+        format("json"), n(1000), p(100), density(0.05), nlambda(20),
+        lambda_min_ratio(0.01), maxit(5000), threads(1),
+        min_time(0.5), min_reps(3), seed(123)
+    {
+        designs.push_back("gaussian");
+        designs.push_back("ar1");
+        designs.push_back("sparse");
+        designs.push_back("genotype");
+        suites.push_back("kernels");
+        suites.push_back("paths");
+    }
+};
+
+// the result of a computation is added here, so that it is not
+// optimized away
+extern volatile double sink;
+inline void keep(double x) { sink = sink + x; }
+
+class Runner
+{
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const Options &opts;
+    bool header;
+
+    static std::string quote(const std::string &s) { return "\"" + s + "\""; }
+
+    void write(const std::string &suite, const std::string &name, const DesignSpec &spec,
+               const std::vector<double> &times, double work, const std::string &unit)
+    {
+        std::vector<double> sorted(times);
+        std::sort(sorted.begin(), sorted.end());
+        const int reps = sorted.size();
+        const double median = (reps % 2) ? sorted[reps / 2] :
+                                           0.5 * (sorted[reps / 2 - 1] + sorted[reps / 2]);
+        const double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / reps;
+
+        std::ostringstream out;
+        out.precision(6);
+        if(opts.format == "csv")
+        {
+            if(!header)
+                std::cout << "suite,name,design,n,p,density,threads,reps,min,median,mean,work,unit\n";
+            header = true;
+            out << suite << "," << name << "," << spec.kind << "," << spec.n << "," << spec.p << ","
+                << spec.density << "," << opts.threads << "," << reps << ","
+                << sorted[0] << "," << median << "," << mean << "," << work << "," << unit;
+        } else {
+            out << "{" << quote("suite") << ":" << quote(suite)
+                << "," << quote("name") << ":" << quote(name)
+                << "," << quote("design") << ":" << quote(spec.kind)
+                << "," << quote("n") << ":" << spec.n
+                << "," << quote("p") << ":" << spec.p
+                << "," << quote("density") << ":" << spec.density
+                << "," << quote("threads") << ":" << opts.threads
+                << "," << quote("reps") << ":" << reps
+                << "," << quote("min") << ":" << sorted[0]
+                << "," << quote("median") << ":" << median
+                << "," << quote("mean") << ":" << mean
+                << "," << quote("work") << ":" << work
+                << "," << quote("unit") << ":" << quote(unit) << "}";
+        }
+        std::cout << out.str() << std::endl;
+    }
+
+public:
+    explicit Runner(const Options &opts_) : opts(opts_), header(false) {}
+
+    const Options &options() const { return opts; }
+
+    bool selected(const std::string &suite, const std::string &name) const
+    {
+        return (suite + "/" + name).find(opts.filter) != std::string::npos;
+    }
+
+    // f() runs the benchmark once and returns its work. a repetition
+    // is calls runs of f(), for kernels that are too fast to be timed
+    // one by one, and its time is divided by calls
+    template<typename Fun>
+    void run(const std::string &suite, const std::string &name, const DesignSpec &spec,
+             const std::string &unit, Fun f, int calls = 1)
+    {
+        if(!selected(suite, name))
+            return;
+
+        std::vector<double> times;
+        double total = 0.0, work = 0.0;
+        while(total < opts.min_time || int(times.size()) < opts.min_reps)
+        {
+            const Clock::time_point start = Clock::now();
+            for(int c = 0; c < calls; c++)
+                work = f();
+            const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            times.push_back(elapsed / calls);
+            total += elapsed;
+        }
+        write(suite, name, spec, times, work, unit);
+    }
+};
+
+// the suites, each runs its benchmarks on one design
+void kernel_benchmarks(Runner &runner, Design &design);
+void path_benchmarks(Runner &runner, Design &design);
+
+
+} // namespace Bench
+
+#endif // BENCH_BENCH_H
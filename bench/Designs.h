@@ -0,0 +1,210 @@
+#ifndef BENCH_DESIGNS_H
+#define BENCH_DESIGNS_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <random>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// synthetic designs for the benchmarks, generated from a seed so that
+// runs on different machines or builds fit the same problems
+//   gaussian:  iid N(0, 1) entries
+//   ar1:       rows N(0, S) with S_ij = phi^|i - j|, correlated neighbours
+//   sparse:    a fraction density of the entries N(0, 1), the rest zero
+//   genotype:  SNP counts 0, 1, 2 ~ Binomial(2, maf) with maf ~ U(0.05, 0.5),
+//              and each SNP a copy of the previous one with probability
+//              ld, in blocks of linkage disequilibrium
+// the response is X * beta + noise with k nonzero coefficients of beta,
+// or Bernoulli with the logistic of it for the binomial family
+namespace Bench {
+
+
+struct DesignSpec
+{
+    std::string kind;
+    int n;
+    int p;
+    double density;        // sparse: fraction of nonzero entries
+    double phi;            // ar1: correlation of neighbouring columns
+    double ld;             // genotype: probability to copy the previous SNP
+    int k;                 // number of nonzero coefficients
+    double snr;            // signal to noise ratio
+    unsigned int seed;
+
+    DesignSpec() :
+        kind("gaussian"), n(1000), p(100), density(0.05), phi(0.5), ld(0.3),
+        k(10), snr(2.0), seed(123)
+    {}
+
+    std::string name() const
+    {
+        return kind + "/n=" + std::to_string(n) + ",p=" + std::to_string(p);
+    }
+};
+
+class Design
+{
+private:
+    typedef Eigen::MatrixXd Matrix;
+    typedef Eigen::VectorXd Vector;
+    typedef Eigen::SparseMatrix<double> SpMat;
+
+    std::mt19937 gen;
+
+    void fill_gaussian()
+    {
+        std::normal_distribution<double> norm(0.0, 1.0);
+        for(int j = 0; j < spec.p; j++)
+            for(int i = 0; i < spec.n; i++)
+                X(i, j) = norm(gen);
+    }
+
+    // column j = phi * column (j - 1) + sqrt(1 - phi^2) * N(0, 1)
+    void fill_ar1()
+    {
+        std::normal_distribution<double> norm(0.0, 1.0);
+        const double phi = spec.phi, s = std::sqrt(1.0 - phi * phi);
+        for(int i = 0; i < spec.n; i++)
+            X(i, 0) = norm(gen);
+        for(int j = 1; j < spec.p; j++)
+            for(int i = 0; i < spec.n; i++)
+                X(i, j) = phi * X(i, j - 1) + s * norm(gen);
+    }
+
+    void fill_sparse()
+    {
+        std::normal_distribution<double> norm(0.0, 1.0);
+        std::bernoulli_distribution nonzero(spec.density);
+        X.setZero();
+        for(int j = 0; j < spec.p; j++)
+            for(int i = 0; i < spec.n; i++)
+                if(nonzero(gen))
+                    X(i, j) = norm(gen);
+    }
+
+    void fill_genotype()
+    {
+        std::uniform_real_distribution<double> maf(0.05, 0.5);
+        std::bernoulli_distribution copy(spec.ld);
+        for(int j = 0; j < spec.p; j++)
+        {
+            if(j > 0 && copy(gen))
+            {
+                X.col(j) = X.col(j - 1);
+                continue;
+            }
+            std::binomial_distribution<int> count(2, maf(gen));
+            for(int i = 0; i < spec.n; i++)
+                X(i, j) = count(gen);
+        }
+    }
+
+public:
+    const DesignSpec spec;
+    Matrix X;
+    SpMat Xs;              // X as a sparse matrix
+    Vector beta;           // true coefficients
+    Vector y;              // gaussian response
+    Vector y01;            // binomial response
+
+    explicit Design(const DesignSpec &spec_) :
+        gen(spec_.seed), spec(spec_), X(spec_.n, spec_.p)
+    {
+        if(spec.kind == "gaussian")
+            fill_gaussian();
+        else if(spec.kind == "ar1")
+            fill_ar1();
+        else if(spec.kind == "sparse")
+            fill_sparse();
+        else if(spec.kind == "genotype")
+            fill_genotype();
+        else
+            throw std::invalid_argument("unknown design '" + spec.kind + "'");
+
+        Xs = X.sparseView();
+
+        // k coefficients of +-1 on evenly spaced columns
+        const int k = std::min(spec.k, spec.p);
+        beta.setZero(spec.p);
+        for(int i = 0; i < k; i++)
+            beta[(long(i) * spec.p) / k] = (i % 2 == 0) ? 1.0 : -1.0;
+
+        const Vector mu = X * beta;
+        const double mean = mu.mean();
+        const double sd = std::sqrt((mu.array() - mean).square().mean());
+        const double sigma = (sd > 0) ? sd / spec.snr : 1.0;
+
+        std::normal_distribution<double> norm(0.0, sigma);
+        std::uniform_real_distribution<double> unif(0.0, 1.0);
+        y.resize(spec.n);
+        y01.resize(spec.n);
+        for(int i = 0; i < spec.n; i++)
+        {
+            y[i] = mu[i] + norm(gen);
+            const double eta = (sd > 0) ? (mu[i] - mean) / sd : 0.0;
+            y01[i] = (unif(gen) < 1.0 / (1.0 + std::exp(-eta))) ? 1.0 : 0.0;
+        }
+    }
+
+    // columns of X centered and scaled to unit sum of squares / n, and
+    // y centered, as DataStd does before the solvers are called. Xs is
+    // left as generated, the sparse solvers take the center and scale
+    void standardize()
+    {
+        const int n = spec.n;
+        for(int j = 0; j < spec.p; j++)
+        {
+            X.col(j).array() -= X.col(j).mean();
+            const double s = X.col(j).norm() / std::sqrt(double(n));
+            if(s > 0)
+                X.col(j) /= s;
+        }
+        y.array() -= y.mean();
+    }
+};
+
+// overlapping groups of size consecutive columns, starting every step
+// columns, for the overlapping group lasso: group is the p x ngroups
+// indicator matrix, and the M = sum of the group sizes replicated
+// coefficients of group g are idx[g], ..., idx[g + 1] - 1
+struct Groups
+{
+    int ngroups;
+    int M;
+    Eigen::SparseMatrix<double> group;
+    Eigen::VectorXd weights;       // sqrt of the group sizes
+    Eigen::VectorXi idx;
+
+    Groups(int p, int size, int step)
+    {
+        std::vector< Eigen::Triplet<double> > entries;
+        std::vector<int> start_idx(1, 0);
+        for(int start = 0; start < p; start += step)
+        {
+            const int end = std::min(start + size, p);
+            for(int j = start; j < end; j++)
+                entries.push_back(Eigen::Triplet<double>(j, start_idx.size() - 1, 1.0));
+            start_idx.push_back(start_idx.back() + end - start);
+            if(end == p)
+                break;
+        }
+        ngroups = start_idx.size() - 1;
+        M = start_idx.back();
+        idx = Eigen::Map<const Eigen::VectorXi>(&start_idx[0], ngroups + 1);
+
+        group.resize(p, ngroups);
+        group.setFromTriplets(entries.begin(), entries.end());
+        weights.resize(ngroups);
+        for(int g = 0; g < ngroups; g++)
+            weights[g] = std::sqrt(double(idx[g + 1] - idx[g]));
+    }
+};
+
+
+} // namespace Bench
+
+#endif // BENCH_DESIGNS_H
@@ -0,0 +1,168 @@
+#include "Bench.h"
+#include "PADMMBase.h"
+#include "ADMMogLassoTall.h"
+#include "Penalty.h"
+#include "Linalg/Gram.h"
+#include "Linalg/AVX.h"
+#include "utils.h"
+
+// the inner kernels of the solvers, each timed on data of the size the
+// solvers pass to it: vectors of length p, the n x p design, and the M
+// replicated coefficients of the overlapping groups
+namespace Bench {
+
+
+// the protected kernels, called through a derived class
+class SparseDiff: public PADMMBase_Master
+{
+public:
+    using PADMMBase_Master::diff_squared_norm;
+};
+
+class GroupThreshold: public ADMMogLassoTall
+{
+public:
+    GroupThreshold(const Eigen::MatrixXd &X, const Eigen::VectorXd &y, const SpMatR &C,
+                   const Groups &groups, const std::string &family,
+                   const Eigen::VectorXi &group_idx) :
+        ADMMogLassoTall(X, y, C, X.rows(), X.cols(), groups.M, groups.ngroups,
+                        family, groups.weights, group_idx, false)
+    {}
+
+    using ADMMogLassoTall::block_soft_threshold;
+};
+
+// runs of a kernel touching len elements in a repetition of about
+// 1e6 elements, at least one
+static int calls_for(double len)
+{
+    return std::max(1, int(1e6 / std::max(len, 1.0)));
+}
+
+void kernel_benchmarks(Runner &runner, Design &design)
+{
+    typedef Eigen::VectorXd Vector;
+    typedef Eigen::SparseVector<double> SparseVector;
+
+    const DesignSpec &spec = design.spec;
+    const Options &opts = runner.options();
+    const int n = spec.n, p = spec.p;
+    const std::string suite = "kernels";
+
+    // soft thresholding of X'y at the median of |X'y|, which keeps
+    // half of the coefficients
+    const Vector xty = design.X.transpose() * design.y;
+    Vector absxty = xty.cwiseAbs();
+    std::nth_element(absxty.data(), absxty.data() + p / 2, absxty.data() + p);
+    const double median = absxty[p / 2];
+    const Eigen::ArrayXd pen_fact = Eigen::ArrayXd::Ones(p);
+
+    SparseVector v1(p), v2(p);
+    runner.run(suite, "soft_threshold", spec, "bytes", [&]() {
+        penalty_prox<true>(v1, xty, median, PenaltyL1(), pen_fact);
+        keep(v1.nonZeros());
+        return 16.0 * p;
+    }, calls_for(p));
+
+    // two supports that differ in about a third of the coefficients
+    penalty_prox(v1, xty, median, PenaltyL1());
+    penalty_prox(v2, xty, 0.5 * median, PenaltyL1());
+    const double nnz = v1.nonZeros() + v2.nonZeros();
+    runner.run(suite, "diff_squared_norm", spec, "bytes", [&]() {
+        keep(SparseDiff::diff_squared_norm(v1, v2));
+        return 12.0 * nnz;
+    }, calls_for(nnz));
+    runner.run(suite, "diff_squared_norm/eigen", spec, "bytes", [&]() {
+        keep((v1 - v2).squaredNorm());
+        return 12.0 * nnz;
+    }, calls_for(nnz));
+
+    // X'X, with the flops of the lower triangle
+    const double gram_flops = double(n) * p * (p + 1);
+    runner.run(suite, "xtx", spec, "flops", [&]() {
+        keep(XtX(design.X)(0, 0));
+        return gram_flops;
+    });
+    Eigen::MatrixXd gram;
+    runner.run(suite, "gram_lower", spec, "flops", [&]() {
+        Linalg::gram_lower(gram, design.X, opts.threads);
+        keep(gram(0, 0));
+        return gram_flops;
+    });
+    Linalg::PackedSym packed;
+    runner.run(suite, "gram_lower/packed", spec, "flops", [&]() {
+        Linalg::gram_lower(packed, design.X, opts.threads);
+        keep(packed.coeff(0, 0));
+        return gram_flops;
+    });
+
+    // X * v and X' * u in single precision, as in the wide solvers
+    const Eigen::MatrixXf Xf = design.X.cast<float>();
+    const Eigen::VectorXf vf = Eigen::VectorXf::Ones(p), uf = design.y.cast<float>();
+    Eigen::VectorXf resn(n), resp(p);
+    const double np = double(n) * p;
+    runner.run(suite, "mat_vec/eigen", spec, "bytes", [&]() {
+        resn.noalias() = Xf * vf;
+        keep(resn[0]);
+        return 4.0 * np;
+    }, calls_for(np));
+    runner.run(suite, "trans_mat_vec/eigen", spec, "bytes", [&]() {
+        resp.noalias() = Xf.transpose() * uf;
+        keep(resp[0]);
+        return 4.0 * np;
+    }, calls_for(np));
+#ifdef __AVX__
+    vtrMatrixf vtrX;
+    vtrX.read_mat(Xf);
+    runner.run(suite, "mat_vec/avx", spec, "bytes", [&]() {
+        vtrX.mult_vec(vf, resn.data());
+        keep(resn[0]);
+        return 4.0 * np;
+    }, calls_for(np));
+    runner.run(suite, "trans_mat_vec/avx", spec, "bytes", [&]() {
+        vtrX.trans_mult_vec(uf, resp.data());
+        keep(resp[0]);
+        return 4.0 * np;
+    }, calls_for(np));
+
+    // the sum and sum of squares of the columns, as in DataStd
+    runner.run(suite, "column_ss/avx", spec, "bytes", [&]() {
+        double s = 0.0, ss = 0.0;
+        for(int j = 0; j < p; j++)
+        {
+            double sj, ssj;
+            get_ss_avx<double>(&design.X(0, j), n, sj, ssj);
+            s += sj;
+            ss += ssj;
+        }
+        keep(s + ss);
+        return 8.0 * np;
+    }, calls_for(np));
+#endif
+    runner.run(suite, "column_ss/eigen", spec, "bytes", [&]() {
+        keep(design.X.colwise().sum().sum() + design.X.colwise().squaredNorm().sum());
+        return 8.0 * np;
+    }, calls_for(np));
+
+    // the overlapping groups of 10 columns, starting every 5 columns
+    if(runner.selected(suite, "block_soft_threshold"))
+    {
+        const Groups groups(p, 10, 5);
+        SpMatR C(groups.M, p);
+        C.reserve(Eigen::VectorXi::Constant(groups.M, 1));
+        createC(C, groups.group, groups.M);
+
+        GroupThreshold solver(design.X, design.y, C, groups, "gaussian", groups.idx);
+
+        Vector d = C * xty, gamma(groups.M);
+        const double lambda = 0.5 * median;
+        runner.run(suite, "block_soft_threshold", spec, "bytes", [&]() {
+            solver.block_soft_threshold(gamma, d, lambda, 1.0);
+            keep(gamma[0]);
+            return 16.0 * groups.M;
+        }, calls_for(groups.M));
+    }
+}
+
+
+} // namespace Bench
@@ -0,0 +1,155 @@
+#include "Bench.h"
+#include "Console.h"
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// penreg-bench [options]
+//   --design  gaussian,ar1,sparse,genotype   designs to run, comma separated
+//   --suite   kernels,paths                  suites to run, comma separated
+//   --filter  STR       only benchmarks whose suite/name contains STR
+//   --n N, --p P        size of the designs
+//   --density D         fraction of nonzero entries of the sparse design
+//   --nlambda K         lambdas of each path
+//   --ratio R           smallest lambda / lambda_zero of the paths
+//   --maxit M           iterations of each lambda
+//   --threads T         threads, and workers of the parallel solvers
+//   --min-time S        seconds of repetitions of each benchmark
+//   --reps R            minimum repetitions of each benchmark
+//   --format json|csv   output, one record per line on stdout
+//   --seed S            seed of the designs
+namespace Bench {
+
+volatile double sink = 0.0;
+
+static std::vector<std::string> split(const std::string &s)
+{
+    std::vector<std::string> res;
+    std::string::size_type start = 0, end;
+    while((end = s.find(',', start)) != std::string::npos)
+    {
+        res.push_back(s.substr(start, end - start));
+        start = end + 1;
+    }
+    res.push_back(s.substr(start));
+    return res;
+}
+
+static bool contains(const std::vector<std::string> &v, const std::string &s)
+{
+    return std::find(v.begin(), v.end(), s) != v.end();
+}
+
+static void usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [--design LIST] [--suite LIST] [--filter STR]\n"
+              << "       [--n N] [--p P] [--density D] [--nlambda K] [--ratio R] [--maxit M]\n"
+              << "       [--threads T] [--min-time S] [--reps R] [--format json|csv] [--seed S]\n";
+}
+
+static Options parse(int argc, char *argv[])
+{
+    Options opts;
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        if(arg == "--help" || arg == "-h")
+        {
+            usage(argv[0]);
+            std::exit(0);
+        }
+        if(i + 1 >= argc)
+        {
+            usage(argv[0]);
+            std::exit(1);
+        }
+
+        const std::string val = argv[++i];
+        if(arg == "--design")
+            opts.designs = split(val);
+        else if(arg == "--suite")
+            opts.suites = split(val);
+        else if(arg == "--filter")
+            opts.filter = val;
+        else if(arg == "--n")
+            opts.n = std::atoi(val.c_str());
+        else if(arg == "--p")
+            opts.p = std::atoi(val.c_str());
+        else if(arg == "--density")
+            opts.density = std::atof(val.c_str());
+        else if(arg == "--nlambda")
+            opts.nlambda = std::atoi(val.c_str());
+        else if(arg == "--ratio")
+            opts.lambda_min_ratio = std::atof(val.c_str());
+        else if(arg == "--maxit")
+            opts.maxit = std::atoi(val.c_str());
+        else if(arg == "--threads")
+            opts.threads = std::atoi(val.c_str());
+        else if(arg == "--min-time")
+            opts.min_time = std::atof(val.c_str());
+        else if(arg == "--reps")
+            opts.min_reps = std::atoi(val.c_str());
+        else if(arg == "--format")
+            opts.format = val;
+        else if(arg == "--seed")
+            opts.seed = std::strtoul(val.c_str(), NULL, 10);
+        else {
+            usage(argv[0]);
+            std::exit(1);
+        }
+    }
+
+    if(opts.n < 2 || opts.p < 2 || opts.nlambda < 1 || opts.threads < 1 || opts.min_reps < 1 ||
+       (opts.format != "json" && opts.format != "csv"))
+    {
+        usage(argv[0]);
+        std::exit(1);
+    }
+    return opts;
+}
+
+
+} // namespace Bench
+
+
+int main(int argc, char *argv[])
+{
+    using namespace Bench;
+
+    const Options opts = parse(argc, argv);
+    set_console(std::cerr);
+#ifdef _OPENMP
+    omp_set_num_threads(opts.threads);
+#endif
+
+    Runner runner(opts);
+    try {
+        for(size_t d = 0; d < opts.designs.size(); d++)
+        {
+            DesignSpec spec;
+            spec.kind = opts.designs[d];
+            spec.n = opts.n;
+            spec.p = opts.p;
+            spec.density = opts.density;
+            spec.seed = opts.seed;
+
+            std::cerr << "design " << spec.name() << std::endl;
+            Design design(spec);
+            if(contains(opts.suites, "kernels"))
+                kernel_benchmarks(runner, design);
+            if(contains(opts.suites, "paths"))
+            {
+                design.standardize();
+                path_benchmarks(runner, design);
+            }
+        }
+    } catch(const std::exception &e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
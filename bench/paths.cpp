@@ -0,0 +1,307 @@
+#include "Bench.h"
+#include "ADMMLassoTall.h"
+#include "ADMMLassoWide.h"
+#include "ADMMLassoLogisticTall.h"
+#include "ADMMLassoTallPrecond.h"
+#include "ADMMLassoTallStream.h"
+#include "ADMMLassoTallPacked.h"
+#include "ADMMGenLassoTall.h"
+#include "ADMMSparseGenridgeTall.h"
+#include "ADMMogLassoTall.h"
+#include "ADMMogLassoLogisticTall.h"
+#include "PADMMLasso.h"
+#include "PADMMLassoWide.h"
+#include "CoordLasso.h"
+#include "CoordMCP.h"
+#include "CoordGLM.h"
+#include "CoordSparse.h"
+#include "CoordMCPder.h"
+#include "Linalg/Gram.h"
+#include "utils.h"
+
+// a path of nlambda fits of each solver on the standardized design,
+// from lambda_zero of the solver down to lambda_min_ratio * lambda_zero
+// on the log scale, warm started as in the R entry points, which also
+// pick the ADMM solvers by the shape of X. a repetition
+// constructs the solver and fits the whole path, and its work is the
+// total number of iterations
+namespace Bench {
+
+
+static Eigen::ArrayXd lambda_path(double lambda0, const Options &opts)
+{
+    Eigen::ArrayXd lambda;
+    lambda.setLinSpaced(opts.nlambda, std::log(lambda0), std::log(lambda0 * opts.lambda_min_ratio));
+    return lambda.exp();
+}
+
+// start(i, lambda) initializes the solver for the i-th lambda
+template<typename Solver, typename Start>
+static double fit_path(Solver &solver, double lambda0, const Options &opts, Start start)
+{
+    const Eigen::ArrayXd lambda = lambda_path(lambda0, opts);
+    double iters = 0.0;
+    for(int i = 0; i < lambda.size(); i++)
+    {
+        start(i, lambda[i]);
+        iters += solver.solve(opts.maxit);
+    }
+    return iters;
+}
+
+// the solvers of the R entry points with init(lambda, rho) for the
+// first lambda and init_warm(lambda) for the others, rho chosen by
+// the solver
+template<typename Solver>
+static double admm_path(Solver &solver, const Options &opts)
+{
+    return fit_path(solver, solver.get_lambda_zero(), opts, [&](int i, double lambda) {
+        if(i == 0)
+            solver.init(lambda, -1.0);
+        else
+            solver.init_warm(lambda);
+    });
+}
+
+// the wide solvers, whose init_warm() also takes the index of lambda
+template<typename Solver>
+static double admm_wide_path(Solver &solver, const Options &opts)
+{
+    return fit_path(solver, solver.get_lambda_zero(), opts, [&](int i, double lambda) {
+        if(i == 0)
+            solver.init(lambda, -1.0);
+        else
+            solver.init_warm(lambda, i);
+    });
+}
+
+template<typename Solver>
+static double coord_path(Solver &solver, const Options &opts)
+{
+    return fit_path(solver, solver.get_lambda_zero(), opts, [&](int i, double lambda) {
+        if(i == 0)
+            solver.init(lambda);
+        else
+            solver.init_warm(lambda);
+    });
+}
+
+template<typename Solver>
+static double concave_path(Solver &solver, double gamma, const Options &opts)
+{
+    return fit_path(solver, solver.get_lambda_zero(), opts, [&](int i, double lambda) {
+        if(i == 0)
+            solver.init(lambda, gamma);
+        else
+            solver.init_warm(lambda, gamma);
+    });
+}
+
+// the first differences, D beta = (beta_2 - beta_1, ..., beta_p - beta_{p-1}),
+// for the fused lasso and the smoothing generalized ridge
+static SpMatR first_differences(int p)
+{
+    std::vector< Eigen::Triplet<double> > entries;
+    for(int i = 0; i < p - 1; i++)
+    {
+        entries.push_back(Eigen::Triplet<double>(i, i, -1.0));
+        entries.push_back(Eigen::Triplet<double>(i, i + 1, 1.0));
+    }
+    SpMatR D(std::max(p - 1, 0), p);
+    D.setFromTriplets(entries.begin(), entries.end());
+    return D;
+}
+
+// ADMM, n > 2p
+static void tall_paths(Runner &runner, Design &design, Eigen::ArrayXd &pen_fact)
+{
+    typedef Eigen::MatrixXd Matrix;
+    typedef Eigen::VectorXd Vector;
+
+    const DesignSpec &spec = design.spec;
+    const Options &opts = runner.options();
+    const int n = spec.n, p = spec.p;
+    const Matrix &X = design.X;
+    const Vector &y = design.y;
+    const Vector &y01 = design.y01;
+    const std::string suite = "paths";
+    const std::string unit = "iters";
+
+    // lasso
+    runner.run(suite, "ADMMLassoTall", spec, unit, [&]() {
+        ADMMLassoTall solver(X, y, pen_fact);
+        return admm_path(solver, opts);
+    });
+    runner.run(suite, "ADMMLassoTallPrecond", spec, unit, [&]() {
+        ADMMLassoTallPrecond solver(X, y, pen_fact);
+        return admm_path(solver, opts);
+    });
+    runner.run(suite, "ADMMLassoLogisticTall", spec, unit, [&]() {
+        ADMMLassoLogisticTall solver(X, y01, pen_fact);
+        return admm_path(solver, opts);
+    });
+
+    // the Gram matrix is the input of the streaming solver, and is
+    // formed once outside the timings
+    if(runner.selected(suite, "ADMMLassoTallStream"))
+    {
+        Matrix XX;
+        Linalg::gram_lower(XX, X, opts.threads);
+        const Vector XY = X.transpose() * y;
+        runner.run(suite, "ADMMLassoTallStream", spec, unit, [&]() {
+            ADMMLassoTallStream solver(XX, XY, pen_fact);
+            return admm_path(solver, opts);
+        });
+    }
+    // the packed solver builds its Gram matrix, which is timed
+    runner.run(suite, "ADMMLassoTallPacked", spec, unit, [&]() {
+        ADMMLassoTallPacked solver(X, y, pen_fact, opts.threads);
+        return admm_path(solver, opts);
+    });
+
+    // consensus ADMM over blocks of rows, on threads, which releases
+    // its copy of X
+    runner.run(suite, "PADMMLasso", spec, unit, [&]() {
+        Matrix Xc = X;
+        PADMMLasso_Master<double> solver(Xc, y, pen_fact, opts.threads);
+        return admm_path(solver, opts);
+    });
+    runner.run(suite, "PADMMLasso/float", spec, unit, [&]() {
+        Matrix Xc = X;
+        PADMMLasso_Master<float> solver(Xc, y, pen_fact, opts.threads, false, 1e-5, 1e-5);
+        return admm_path(solver, opts);
+    });
+
+    // generalized lasso and generalized ridge with the first differences.
+    // ADMMGenLassoWide is left out as in genlasso.cpp, it does not run yet
+    const SpMatR D = first_differences(p);
+    runner.run(suite, "ADMMGenLassoTall", spec, unit, [&]() {
+        ADMMGenLassoTall solver(X, y, D);
+        return admm_path(solver, opts);
+    });
+    runner.run(suite, "ADMMSparseGenridgeTall", spec, unit, [&]() {
+        const double alpha = 0.5;
+        ADMMSparseGenridgeTall solver(X, y, D);
+        return fit_path(solver, solver.get_lambda_zero(), opts, [&](int i, double lambda) {
+            if(i == 0)
+                solver.init(lambda * alpha, alpha, pen_fact, -1.0);
+            else
+                solver.init_warm(lambda * alpha);
+        });
+    });
+
+    // overlapping group lasso, groups of 10 columns starting every 5
+    if(runner.selected(suite, "ADMMogLassoTall") || runner.selected(suite, "ADMMogLassoLogisticTall"))
+    {
+        const Groups groups(p, 10, 5);
+        SpMatR C(groups.M, p);
+        C.reserve(Eigen::VectorXi::Constant(groups.M, 1));
+        createC(C, groups.group, groups.M);
+
+        runner.run(suite, "ADMMogLassoTall", spec, unit, [&]() {
+            ADMMogLassoTall solver(X, y, C, n, p, groups.M, groups.ngroups,
+                                   "gaussian", groups.weights, groups.idx, false);
+            return admm_path(solver, opts);
+        });
+        runner.run(suite, "ADMMogLassoLogisticTall", spec, unit, [&]() {
+            ADMMogLassoLogisticTall solver(X, y01, C, n, p, groups.M, groups.ngroups,
+                                           "binomial", groups.weights, groups.idx, false);
+            return admm_path(solver, opts);
+        });
+    }
+}
+
+// ADMM, n <= 2p, and sharing ADMM over blocks of columns
+static void wide_paths(Runner &runner, Design &design, Eigen::ArrayXd &pen_fact)
+{
+    typedef Eigen::MatrixXd Matrix;
+    typedef Eigen::VectorXd Vector;
+
+    const DesignSpec &spec = design.spec;
+    const Options &opts = runner.options();
+    const Matrix &X = design.X;
+    const Vector &y = design.y;
+    const std::string suite = "paths";
+    const std::string unit = "iters";
+
+    runner.run(suite, "ADMMLassoWide", spec, unit, [&]() {
+        ADMMLassoWide solver(X, y, pen_fact);
+        return admm_wide_path(solver, opts);
+    });
+    runner.run(suite, "PADMMLassoWide", spec, unit, [&]() {
+        PADMMLassoWide_Master solver(X, y, pen_fact, opts.threads);
+        return admm_wide_path(solver, opts);
+    });
+}
+
+void path_benchmarks(Runner &runner, Design &design)
+{
+    typedef Eigen::MatrixXd Matrix;
+    typedef Eigen::VectorXd Vector;
+
+    const DesignSpec &spec = design.spec;
+    const Options &opts = runner.options();
+    const int n = spec.n, p = spec.p;
+    const Matrix &X = design.X;
+    const Vector &y = design.y;
+    const Vector &y01 = design.y01;
+    Eigen::ArrayXd pen_fact = Eigen::ArrayXd::Ones(p);
+    const std::string suite = "paths";
+    const std::string unit = "iters";
+
+    // the ADMM solvers for the shape of X that the R entry points use
+    // them for, tall if n > 2p and wide otherwise
+    if(n > 2 * p)
+        tall_paths(runner, design, pen_fact);
+    else
+        wide_paths(runner, design, pen_fact);
+
+    // coordinate descent
+    runner.run(suite, "CoordLasso", spec, unit, [&]() {
+        CoordLasso solver(X, y, pen_fact, 1e-6, false, false, opts.threads);
+        return coord_path(solver, opts);
+    });
+    runner.run(suite, "CoordLasso/covariance", spec, unit, [&]() {
+        CoordLasso solver(X, y, pen_fact, 1e-6, true, true, opts.threads);
+        return coord_path(solver, opts);
+    });
+    runner.run(suite, "CoordMCP", spec, unit, [&]() {
+        CoordMCP solver(X, y, pen_fact, 1e-6, false, true, opts.threads);
+        return concave_path(solver, 3.0, opts);
+    });
+    runner.run(suite, "CoordSCAD", spec, unit, [&]() {
+        CoordSCAD solver(X, y, pen_fact, 1e-6, false, true, opts.threads);
+        return concave_path(solver, 3.7, opts);
+    });
+    runner.run(suite, "CoordMCPder", spec, unit, [&]() {
+        // all the rows enter the loss
+        int num_loss = n;
+        CoordMCPder solver(X, y, pen_fact, num_loss, 1e-6, true);
+        return concave_path(solver, 3.0, opts);
+    });
+    runner.run(suite, "CoordGLM/binomial", spec, unit, [&]() {
+        CoordGLM<PenaltyL1, FamilyBinomial> solver(X, y01, pen_fact, true, 1e-7, true);
+        return coord_path(solver, opts);
+    });
+
+    // the sparse design as generated, centered and scaled on the fly
+    if(runner.selected(suite, "CoordSparse"))
+    {
+        Eigen::ArrayXd center(p), scale(p);
+        for(int j = 0; j < p; j++)
+        {
+            const Vector col = design.Xs.col(j);
+            center[j] = col.mean();
+            scale[j] = std::sqrt((col.array() - center[j]).square().mean());
+            if(scale[j] == 0)
+                scale[j] = 1.0;
+        }
+        runner.run(suite, "CoordSparse", spec, unit, [&]() {
+            CoordSparse<PenaltyL1> solver(design.Xs, y, center, scale, pen_fact, 1e-6, true);
+            return coord_path(solver, opts);
+        });
+    }
+}
+
+
+} // namespace Bench
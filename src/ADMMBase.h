@@ -1,8 +1,12 @@
 #ifndef ADMMBASE_H
 #define ADMMBASE_H
 
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "Console.h"
 #include "Linalg/BlasWrapper.h"
+#include "Telemetry.h"
+#include "Deadline.h"
 
 // General problem setting
 //   minimize f(x) + g(z)
@@ -32,6 +36,9 @@ protected:
     double resid_primal;  // primal residual
     double resid_dual;    // dual residual
 
+    SolverTelemetry *telemetry;  // timings of the phases, NULL if not recorded
+    SolveDeadline *deadline;     // time budget and interruption, NULL if none
+
     virtual void A_mult (VecTypeNu &res, VecTypeBeta &x) = 0;   // operation res -> Ax, x can be overwritten
     virtual void At_mult(VecTypeNu &res, VecTypeNu &y) = 0;   // operation res -> A'y, y can be overwritten
     virtual void B_mult (VecTypeNu &res, VecTypeGamma &z) = 0;   // operation res -> Bz, z can be overwritten
@@ -81,31 +88,45 @@ protected:
 
         return rho * dual.norm();
     }
+    // rho_changed_action() for a new rho, timed and
+    // counted as a factorization
+    void refactor()
+    {
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::FACTORIZE);
+        rho_changed_action();
+        if(telemetry)
+            telemetry->refactored();
+    }
     // increase or decrease rho in iterations
     virtual void update_rho()
     {
+        const double old_rho = rho;
+
         if(resid_primal / eps_primal > 10 * resid_dual / eps_dual)
         {
             rho *= 2;
-            rho_changed_action();
+            refactor();
         }
         else if(resid_dual / eps_dual > 10 * resid_primal / eps_primal)
         {
             rho /= 2;
-            rho_changed_action();
+            refactor();
         }
 
         if(resid_primal < eps_primal)
         {
             rho /= 1.2;
-            rho_changed_action();
+            refactor();
         }
         
         if(resid_dual < eps_dual)
         {
             rho *= 1.2;
-            rho_changed_action();
+            refactor();
         }
+
+        if(telemetry && rho != old_rho)
+            telemetry->rho_changed();
     }
     // Debugging residual information
     void print_header(std::string title)
@@ -113,36 +134,36 @@ protected:
         const int width = 80;
         const char sep = ' ';
 
-        Rcpp::Rcout << std::endl << std::string(width, '=') << std::endl;
-        Rcpp::Rcout << std::string((width - title.length()) / 2, ' ') << title << std::endl;
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::endl << std::string(width, '=') << std::endl;
+        console() << std::string((width - title.length()) / 2, ' ') << title << std::endl;
+        console() << std::string(width, '-') << std::endl;
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << "iter";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "rho";
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << "iter";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "rho";
+        console() << std::endl;
 
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::string(width, '-') << std::endl;
     }
     void print_row(int iter)
     {
         const char sep = ' ';
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << iter;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << rho;
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << iter;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << rho;
+        console() << std::endl;
     }
     void print_footer()
     {
         const int width = 80;
-        Rcpp::Rcout << std::string(width, '=') << std::endl << std::endl;
+        console() << std::string(width, '=') << std::endl << std::endl;
     }
 
 public:
@@ -150,15 +171,21 @@ public:
              double eps_abs_ = 1e-6, double eps_rel_ = 1e-6) :
         dim_main(n_), dim_aux(m_), dim_dual(p_),
         main_beta(n_), aux_gamma(m_), dual_nu(p_),  // allocate space but do not set values
-        eps_abs(eps_abs_), eps_rel(eps_rel_)
+        eps_abs(eps_abs_), eps_rel(eps_rel_),
+        telemetry(NULL), deadline(NULL)
     {}
 
     virtual ~ADMMBase() {}
 
     void update_beta()
     {
-        eps_primal = compute_eps_primal();
-        eps_dual = compute_eps_dual();
+        {
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
+            eps_primal = compute_eps_primal();
+            eps_dual = compute_eps_dual();
+        }
+
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::X_UPDATE);
 
         VecTypeBeta newx(dim_main);
         next_beta(newx);
@@ -167,14 +194,19 @@ public:
     void update_gamma()
     {
         VecTypeGamma newgamma(dim_aux);
-        next_gamma(newgamma);
+        {
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Z_UPDATE);
+            next_gamma(newgamma);
+        }
 
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
         resid_dual = compute_resid_dual(newgamma);
 
         aux_gamma.swap(newgamma);
     }
     void update_nu()
     {
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Y_UPDATE);
         VecTypeNu newr(dim_dual);
         next_residual(newr);
 
@@ -203,19 +235,35 @@ public:
             update_nu();
 
             // print_row(i);
+            if(telemetry)
+                telemetry->sample(i, resid_primal, resid_dual, rho);
 
             if(converged())
                 break;
 
+            if(deadline && deadline->expired())
+                break;
+
             if(i > 3)
                 update_rho();
         }
 
         // print_footer();
+        if(telemetry && maxit > 0)
+            telemetry->finish(std::min(i, maxit - 1), resid_primal, resid_dual, rho);
 
         return i + 1;
     }
 
+    // records the phases of the following fits in telemetry_
+    void set_telemetry(SolverTelemetry *telemetry_) { telemetry = telemetry_; }
+
+    // stops the following fits after the iteration in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+
+    double get_resid_primal() const { return resid_primal; }
+    double get_resid_dual() const { return resid_dual; }
+
     virtual VecTypeBeta get_beta() { return main_beta; }
     virtual VecTypeGamma get_gamma() { return aux_gamma; }
     virtual VecTypeNu get_nu() { return dual_nu; }
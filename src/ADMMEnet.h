@@ -3,6 +3,7 @@
 
 #include "ADMMLassoTall.h"
 #include "ADMMLassoWide.h"
+#include "Penalty.h"
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * enet(beta)
 //
@@ -23,20 +24,7 @@ private:
 
     void enet(SparseVector &res, const Vector &vec, const double &penalty)
     {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-
-        const Scalar thresh = alpha * penalty;
-        const Scalar denom = 1.0 + penalty * (1.0 - alpha);
-        const Scalar *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            if(ptr[i] > thresh)
-                res.insertBack(i) = (ptr[i] - thresh) / denom;
-            else if(ptr[i] < -thresh)
-                res.insertBack(i) = (ptr[i] + thresh) / denom;
-        }
+        penalty_prox(res, vec, penalty, PenaltyEnet(alpha));
     }
     void next_gamma(SparseVector &res)
     {
@@ -66,20 +54,7 @@ private:
 
     void enet(SparseVector &res, const Vector &vec, const double &penalty)
     {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-
-        const Scalar thresh = alpha * penalty;
-        const Scalar denom = 1.0 + penalty * (1.0 - alpha);
-        const Scalar *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            if(ptr[i] > thresh)
-                res.insertBack(i) = (ptr[i] - thresh) / denom;
-            else if(ptr[i] < -thresh)
-                res.insertBack(i) = (ptr[i] + thresh) / denom;
-        }
+        penalty_prox(res, vec, penalty, PenaltyEnet(alpha));
     }
 
     void active_set_update(SparseVector &res)
@@ -6,6 +6,7 @@
 #include "Spectra/SymEigsSolver.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
+#include "Penalty.h"
 #include <Eigen/Geometry>
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
@@ -66,20 +67,7 @@ protected:
     
     static void soft_threshold(SparseVector &res, const Vector &vec, const double &penalty, const Vector &pen_fact)
     {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-        
-        const double *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            double total_pen = pen_fact(i) * penalty;
-            
-            if(ptr[i] > total_pen)
-                res.insertBack(i) = ptr[i] - total_pen;
-            else if(ptr[i] < -total_pen)
-                res.insertBack(i) = ptr[i] + total_pen;
-        }
+        penalty_prox<true>(res, vec, penalty, PenaltyL1(), pen_fact);
     }
     
     void next_beta(Vector &res)
@@ -319,6 +307,7 @@ public:
         
         int i;
         int j;
+        int iters = 0;  // ADMM iterations over all the IRLS steps
         for (i = 0; i < newton_maxit; ++i)
         {
             
@@ -345,7 +334,10 @@ public:
             }
             
             // compute X'WX
-            XX = XtWX(datX, W);
+            {
+                SolverTelemetry::Timer timer(telemetry, SolverTelemetry::FACTORIZE);
+                XX = XtWX(datX, W);
+            }
             
             // compute X'Wz
             grad = datX.adjoint() * (datY.array() - prob.array()).matrix();
@@ -359,7 +351,7 @@ public:
             compute_rho();
             
             // reset LDLT solver with new XX
-            rho_changed_action();
+            refactor();
             
             
             if (i > 0) 
@@ -381,9 +373,15 @@ public:
                 update_nu();
                 
                 // print_row(i);
+                if(telemetry)
+                    telemetry->sample(iters, resid_primal, resid_dual, rho);
+                iters++;
                 
                 if(converged())
                     break;
+
+                if(deadline && deadline->expired())
+                    break;
                 
                 double old_c = adj_c;
                 adj_c = compute_resid_combined();
@@ -408,6 +406,10 @@ public:
                     update_rho();
             }
             
+            // stopped within the IRLS step
+            if(deadline && deadline->stopped())
+                break;
+            
             VectorXd dx = beta_prev - main_beta;
             if (std::abs(XY.adjoint() * dx) < newton_tol)
             {
@@ -417,6 +419,8 @@ public:
             
         }
         // print_footer();
+        if(telemetry && iters > 0)
+            telemetry->finish(iters - 1, resid_primal, resid_dual, rho);
         
         return i + 1;
     }
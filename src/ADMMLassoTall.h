@@ -6,6 +6,7 @@
 #include "Spectra/SymEigsSolver.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
+#include "Penalty.h"
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
 //
@@ -60,20 +61,7 @@ protected:
     
     static void soft_threshold(SparseVector &res, const Vector &vec, const double &penalty, const Vector &pen_fact)
     {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-        
-        const double *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            double total_pen = pen_fact(i) * penalty;
-            
-            if(ptr[i] > total_pen)
-                res.insertBack(i) = ptr[i] - total_pen;
-            else if(ptr[i] < -total_pen)
-                res.insertBack(i) = ptr[i] + total_pen;
-        }
+        penalty_prox<true>(res, vec, penalty, PenaltyL1(), pen_fact);
     }
     
     void next_beta(Vector &res)
@@ -177,6 +165,26 @@ protected:
         return rho * resid_primal * resid_primal + rho * diff_squared_norm(aux_gamma, adj_gamma);
     }
     
+    // constructor from the sufficient statistics X'X (lower triangle)
+    // and X'Y only, e.g. for cross-validation folds. the solver never
+    // uses the rows of X. p_ is the number of variables
+    ADMMLassoTall(int p_,
+                  const Matrix &XX_,
+                  const Vector &XY_,
+                  ArrayXd &penalty_factor_,
+                  double eps_abs_ = 1e-6,
+                  double eps_rel_ = 1e-6) :
+    FADMMBase<Eigen::VectorXd, Eigen::SparseVector<double>, Eigen::VectorXd>
+               (p_, p_, p_,
+              eps_abs_, eps_rel_),
+              datX(NULL, 0, p_),
+              datY(NULL, 0),
+              penalty_factor(penalty_factor_),
+              XY(XY_),
+              XX(XX_),
+              lambda0(XY.cwiseAbs().maxCoeff())
+    {}
+    
 public:
     ADMMLassoTall(ConstGenericMatrix &datX_, 
                   ConstGenericVector &datY_,
@@ -215,12 +223,16 @@ public:
         
         if(rho <= 0)
         {
-            MatOpSymLower<Double> op(XX);
-            Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, MatOpSymLower<Double> > eigs(&op, 1, 3);
-            srand(0);
-            eigs.init();
-            eigs.compute(100, 0.1);
-            savedEigs = eigs.eigenvalues();
+            // X'X does not change, so the eigenvalue is computed once
+            if(savedEigs.size() == 0)
+            {
+                MatOpSymLower<Double> op(XX);
+                Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, MatOpSymLower<Double> > eigs(&op, 1, 3);
+                srand(0);
+                eigs.init();
+                eigs.compute(100, 0.1);
+                savedEigs = eigs.eigenvalues();
+            }
             rho = std::pow(savedEigs[0], 1.0 / 3) * std::pow(lambda, 2.0 / 3);
         }
         
@@ -235,7 +247,7 @@ public:
         adj_a = 1.0;
         adj_c = 9999;
         
-        rho_changed_action();
+        refactor();
     }
     // when computing for the next lambda, we can use the
     // current main_beta, aux_gamma, dual_nu and rho as initial values
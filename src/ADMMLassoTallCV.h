@@ -0,0 +1,65 @@
+#ifndef ADMMLASSOTALLCV_H
+#define ADMMLASSOTALLCV_H
+
+#include "ADMMLassoTall.h"
+#include "CVFold.h"
+
+// ADMMLassoTall on the training rows of a cross-validation fold.
+// X'X of the training rows is X'X - U * U' for the n_k + 1 columns
+// of U = [X_k', sqrt(m) * meanX] (see CVFold), so for unscaled columns
+// the factorization of X'X + rho * I over all rows, shared by the
+// folds, is turned into that of the fold by n_k + 1 rank one
+// downdates instead of a new factorization
+class ADMMLassoTallCV: public ADMMLassoTall
+{
+private:
+    const LDLT *base_solver;      // factorization of X'X + rho_base * I over all rows, or NULL
+    double rho_base;
+    Matrix downdate;              // U above
+    
+    void rho_changed_action()
+    {
+        // after rho is changed by update_rho() the shared factorization
+        // no longer applies, so the fold Gram matrix is factorized
+        if (base_solver == NULL || rho != rho_base)
+        {
+            ADMMLassoTall::rho_changed_action();
+            return;
+        }
+        
+        solver = *base_solver;
+        for (int k = 0; k < downdate.cols(); k++)
+            solver.rankUpdate(downdate.col(k), -1.0);
+    }
+    
+    static Matrix fold_gram(const CVFold &fold, const Matrix &XX_full)
+    {
+        Matrix res;
+        fold.gram_lower(XX_full, res);
+        return res;
+    }
+
+public:
+    // base_solver_ may be NULL, and must be NULL if the columns are scaled
+    ADMMLassoTallCV(const CVFold &fold,
+                    const Matrix &XX_full,
+                    ArrayXd &penalty_factor_,
+                    const LDLT *base_solver_,
+                    double rho_base_,
+                    double eps_abs_ = 1e-6,
+                    double eps_rel_ = 1e-6) :
+    ADMMLassoTall(fold.XY.size(), fold_gram(fold, XX_full), fold.XY, penalty_factor_,
+                  eps_abs_, eps_rel_),
+    base_solver(base_solver_),
+    rho_base(rho_base_)
+    {
+        if (base_solver != NULL)
+            downdate = fold.downdate_vectors();
+    }
+    
+    double get_rho() const { return rho; }
+};
+
+
+
+#endif // ADMMLASSOTALLCV_H
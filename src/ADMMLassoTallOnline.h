@@ -0,0 +1,184 @@
+#ifndef ADMMLASSOTALLONLINE_H
+#define ADMMLASSOTALLONLINE_H
+
+#include <vector>
+#include "ADMMLassoTall.h"
+#include "StreamGram.h"
+
+// ADMMLassoTall for observations that arrive in batches of rows (an
+// external pointer on the R side, see admm_lasso_online_new()). X'X
+// and X'y are accumulated by StreamGram, and appending k rows changes
+// the centred X'X by the k + 1 rank one terms
+//
+//   (x_i - m_new) * (x_i - m_new)',  n_old * (m_old - m_new) * (m_old - m_new)'
+//
+// (only x_i * x_i' without an intercept), so for unscaled columns the
+// factorization of X'X + rho * I is updated in O(k * p^2) instead of
+// computed again in O(p^3), as in ADMMLassoTallCV. the solution of each
+// lambda of the path is kept, and the next fit of the path starts from
+// it, so it typically takes a few iterations per lambda
+class ADMMLassoTallOnline: public ADMMLassoTall
+{
+private:
+    typedef Eigen::Array<double, Eigen::Dynamic, 1> Array;
+    
+    StreamGram stats;
+    const bool standardize;
+    const bool intercept;
+    const double rho_user;        // rho given by the user, or <= 0
+    
+    bool factorized;              // does solver hold the factorization for XX and rho?
+    int n_rho;                    // number of rows when rho was chosen
+    
+    // the solution for each lambda of the path
+    std::vector<bool> fitted;
+    Matrix betas;
+    std::vector<SparseVector> gammas;
+    Matrix nus;
+    
+    void rho_changed_action()
+    {
+        ADMMLassoTall::rho_changed_action();
+        factorized = true;
+    }
+    
+    void update_factorization(ConstGenericMatrix &rows, const Array &m_old, int n_old)
+    {
+        const int k = rows.rows();
+        const Array m_new = stats.mean_x();
+    
+        Vector v(dim_main);
+        for (int i = 0; i < k; i++)
+        {
+            v = rows.row(i).transpose();
+            if (intercept)
+                v -= m_new.matrix();
+            solver.rankUpdate(v, 1.0);
+        }
+        if (intercept && n_old > 0)
+        {
+            v = std::sqrt(double(n_old)) * (m_old - m_new).matrix();
+            solver.rankUpdate(v, 1.0);
+        }
+    }
+    
+public:
+    ArrayXd path;                 // the lambda path on the original scale, see set_path()
+    
+    ADMMLassoTallOnline(int p_,
+                        ArrayXd &penalty_factor_,
+                        bool standardize_,
+                        bool intercept_,
+                        double rho_,
+                        double eps_abs_ = 1e-6,
+                        double eps_rel_ = 1e-6) :
+    ADMMLassoTall(p_, Matrix(), Vector::Zero(p_), penalty_factor_,
+                  eps_abs_, eps_rel_),
+    stats(p_, standardize_, intercept_),
+    standardize(standardize_),
+    intercept(intercept_),
+    rho_user(rho_),
+    factorized(false),
+    n_rho(0)
+    {}
+    
+    int nobs() const { return stats.n; }
+    
+    // adds k rows (a k x p matrix) and their responses, and returns the
+    // standardization of all the rows so far
+    DataStd<double> append(ConstGenericMatrix &rows, const double *y)
+    {
+        const int k = rows.rows();
+        const int n_old = stats.n;
+        const Array m_old = (n_old > 0) ? stats.mean_x() : Array::Zero(dim_main);
+    
+        stats.add_rows(rows, y);
+        DataStd<double> datstd = stats.standardized(XX, XY);
+        lambda0 = XY.cwiseAbs().maxCoeff();
+    
+        // the heuristic of cv_admm_lasso(): k + 1 rank one updates of
+        // cost p^2 each against p^3 / 6 for the factorization. scaled
+        // columns change scale with every batch, so X'X is factorized
+        if (factorized && !standardize && 6 * (k + 1) < dim_main)
+            update_factorization(rows, m_old, n_old);
+        else
+            factorized = false;
+    
+        // the dual variable is a gradient of the loss, which grows with n
+        if (n_old > 0)
+            nus *= double(stats.n) / n_old;
+    
+        return datstd;
+    }
+    
+    // sets the lambda path (on the original scale) for all later fits
+    void set_path(const ArrayXd &lambda_)
+    {
+        const int nlambda = lambda_.size();
+        path = lambda_;
+        fitted.assign(nlambda, false);
+        betas.resize(dim_main, nlambda);
+        gammas.assign(nlambda, SparseVector(dim_main));
+        nus.resize(dim_dual, nlambda);
+    }
+    
+    // solves for path[i], with ilambda that lambda on the scale of the
+    // standardized problem. the first fit of the path starts from zero
+    // and goes down the path as ADMMLassoTall does, later fits start
+    // from the solution of the previous fit for the same lambda
+    int fit(int i, double ilambda, int maxit)
+    {
+        if (!fitted[i])
+        {
+            if (i == 0)
+            {
+                init(ilambda, rho_user);
+                n_rho = stats.n;
+            } else {
+                init_warm(ilambda);
+            }
+        } else {
+            if (i == 0)
+            {
+                // the default rho grows with X'X, so it is chosen again
+                // once the number of rows has doubled
+                if (rho_user <= 0 && stats.n >= 2 * n_rho)
+                {
+                    savedEigs.resize(0);
+                    init(ilambda, -1.0);
+                    n_rho = stats.n;
+                } else if (!factorized) {
+                    rho_changed_action();
+                }
+            }
+    
+            main_beta = betas.col(i);
+            aux_gamma = gammas[i];
+            dual_nu = nus.col(i);
+            adj_gamma = aux_gamma;
+            adj_nu = dual_nu;
+            lambda = ilambda;
+    
+            eps_primal = 0.0;
+            eps_dual = 0.0;
+            resid_primal = 9999;
+            resid_dual = 9999;
+    
+            adj_a = 1.0;
+            adj_c = 9999;
+        }
+    
+        const int niter = solve(maxit);
+    
+        betas.col(i) = main_beta;
+        gammas[i] = aux_gamma;
+        nus.col(i) = dual_nu;
+        fitted[i] = true;
+    
+        return niter;
+    }
+};
+
+
+
+#endif // ADMMLASSOTALLONLINE_H
@@ -0,0 +1,69 @@
+#ifndef ADMMLASSOTALLPACKED_H
+#define ADMMLASSOTALLPACKED_H
+
+#include <stdexcept>
+#include "ADMMLassoTall.h"
+#include "Linalg/Gram.h"
+
+// ADMMLassoTall with X'X in packed storage (Linalg::PackedSym), for
+// large p. X'X and the Cholesky factor of X'X + rho * I (LAPACK dpptrf)
+// take p * (p + 1) / 2 doubles each, where ADMMLassoTall holds X'X, a
+// shifted copy and its LDLT factor, three p x p matrices
+class ADMMLassoTallPacked: public ADMMLassoTall
+{
+private:
+    typedef Linalg::PackedSym PackedSym;
+
+    PackedSym XXp;                // X'X
+    PackedSym factor;             // Cholesky factor of X'X + rho * I
+
+    void next_beta(Vector &res)
+    {
+        Vector rhs = XY - adj_nu;
+        for(SparseVector::InnerIterator iter(adj_gamma); iter; ++iter)
+            rhs[iter.index()] += rho * iter.value();
+
+        factor.cholesky_solve(rhs);
+        res.swap(rhs);
+    }
+
+    void rho_changed_action()
+    {
+        factor = XXp;
+        factor.add_to_diag(rho);
+        if (!factor.cholesky())
+            throw std::runtime_error("X'X + rho * I is not positive definite");
+    }
+
+public:
+    // datX_ and datY_ standardized. X'X is built by Linalg::gram_lower()
+    // with nthreads threads
+    ADMMLassoTallPacked(ConstGenericMatrix &datX_,
+                        ConstGenericVector &datY_,
+                        ArrayXd &penalty_factor_,
+                        int nthreads,
+                        double eps_abs_ = 1e-6,
+                        double eps_rel_ = 1e-6) :
+    ADMMLassoTall(datX_.cols(), Matrix(), datX_.transpose() * datY_, penalty_factor_,
+                  eps_abs_, eps_rel_)
+    {
+        Linalg::gram_lower(XXp, datX_, nthreads);
+    }
+
+    void init(double lambda_, double rho_)
+    {
+        if (rho_ <= 0 && savedEigs.size() == 0)
+        {
+            Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, PackedSym > eigs(&XXp, 1, 3);
+            srand(0);
+            eigs.init();
+            eigs.compute(100, 0.1);
+            savedEigs = eigs.eigenvalues();
+        }
+        ADMMLassoTall::init(lambda_, rho_);
+    }
+};
+
+
+
+#endif // ADMMLASSOTALLPACKED_H
@@ -6,6 +6,7 @@
 #include "Spectra/SymEigsSolver.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
+#include "Penalty.h"
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
 //
@@ -60,20 +61,7 @@ protected:
     
     static void soft_threshold(SparseVector &res, const Vector &vec, const double &penalty, const Vector &pen_fact)
     {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-        
-        const double *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            double total_pen = pen_fact(i) * penalty;
-            
-            if(ptr[i] > total_pen)
-                res.insertBack(i) = ptr[i] - total_pen;
-            else if(ptr[i] < -total_pen)
-                res.insertBack(i) = ptr[i] + total_pen;
-        }
+        penalty_prox<true>(res, vec, penalty, PenaltyL1(), pen_fact);
     }
     
     void next_beta(Vector &res)
@@ -0,0 +1,42 @@
+#ifndef ADMMLASSOTALLPREPARED_H
+#define ADMMLASSOTALLPREPARED_H
+
+#include "ADMMLassoTall.h"
+#include "PreparedDesign.h"
+
+// ADMMLassoTall for a prepared design (PreparedDesign.h). the solver
+// keeps no copy of X'X: the largest eigenvalue that sets the default
+// rho and the factorizations of X'X + rho * I are those cached by the
+// design, so a fit on a prepared design costs X'y and the iterations
+class ADMMLassoTallPrepared: public ADMMLassoTall
+{
+private:
+    PreparedDesign &design;
+    
+    void rho_changed_action()
+    {
+        solver = design.factorization(rho);
+    }
+
+public:
+    // datY is the response standardized by design.standardize_response()
+    ADMMLassoTallPrepared(PreparedDesign &design_, const Vector &datY,
+                          ArrayXd &penalty_factor_,
+                          double eps_abs_ = 1e-6,
+                          double eps_rel_ = 1e-6) :
+    ADMMLassoTall(design_.p, Matrix(), design_.X.transpose() * datY, penalty_factor_,
+                  eps_abs_, eps_rel_),
+    design(design_)
+    {}
+    
+    void init(double lambda_, double rho_)
+    {
+        if (rho_ <= 0 && savedEigs.size() == 0)
+            savedEigs = Vector::Constant(1, design.max_eigenvalue());
+        ADMMLassoTall::init(lambda_, rho_);
+    }
+};
+
+
+
+#endif // ADMMLASSOTALLPREPARED_H
@@ -0,0 +1,26 @@
+#ifndef ADMMLASSOTALLSTREAM_H
+#define ADMMLASSOTALLSTREAM_H
+
+#include "ADMMLassoTall.h"
+#include "StreamGram.h"
+
+// ADMMLassoTall from the standardized X'X and X'y accumulated by
+// StreamGram, for data that are read from a file in blocks of rows
+// and never held in memory as a whole
+class ADMMLassoTallStream: public ADMMLassoTall
+{
+public:
+    // XX_ (lower triangle) and XY_ from StreamGram::standardized()
+    ADMMLassoTallStream(const Matrix &XX_,
+                        const Vector &XY_,
+                        ArrayXd &penalty_factor_,
+                        double eps_abs_ = 1e-6,
+                        double eps_rel_ = 1e-6) :
+    ADMMLassoTall(XY_.size(), XX_, XY_, penalty_factor_,
+                  eps_abs_, eps_rel_)
+    {}
+};
+
+
+
+#endif // ADMMLASSOTALLSTREAM_H
@@ -6,6 +6,7 @@
 #include "Spectra/SymEigsSolver.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
+#include "Penalty.h"
 
 #ifdef __AVX__
 #include "Linalg/AVX.h"
@@ -73,20 +74,7 @@ protected:
 
 static void soft_threshold(SparseVector &res, const Vector &vec, const double &penalty, const Vector &pen_fact)
 {
-    int v_size = vec.size();
-    res.setZero();
-    res.reserve(v_size);
-    
-    const double *ptr = vec.data();
-    for(int i = 0; i < v_size; i++)
-    {
-        double total_pen = pen_fact(i) * penalty;
-        
-        if(ptr[i] > total_pen)
-            res.insertBack(i) = ptr[i] - total_pen;
-        else if(ptr[i] < -total_pen)
-            res.insertBack(i) = ptr[i] + total_pen;
-    }
+    penalty_prox<true>(res, vec, penalty, PenaltyL1(), pen_fact);
 }
 
     virtual void active_set_update(SparseVector &res, const Vector &pen_fact)
@@ -125,15 +113,6 @@ static void soft_threshold(SparseVector &res, const Vector &vec, const double &p
         res.prune(0.0);
     }
 
-    // 4^k - 1, k = 0, 1, 2, ...
-    static bool is_regular_update(unsigned int x)
-    {
-        if(x == 0 || x == 3 || x == 15 || x == 63)  return true;
-        x++;
-        if( x & (x - 1) )  return false;
-        return x & 0x55555555;
-    }
-
     virtual void next_beta(SparseVector &res)
     {
         if(lambda > lambda0 - 1e-5)
@@ -194,30 +173,50 @@ static void soft_threshold(SparseVector &res, const Vector &vec, const double &p
     }
 
 public:
+    // iterations with a full update of beta, the others only update its
+    // nonzeros. 4^k - 1, k = 0, 1, 2, ...
+    static bool is_regular_update(unsigned int x)
+    {
+        if(x == 0 || x == 3 || x == 15 || x == 63)  return true;
+        x++;
+        if( x & (x - 1) )  return false;
+        return x & 0x55555555;
+    }
+
+    // largest eigenvalue of XX', the spectral radius of X'X
+    static double spectral_radius(ConstGenericMatrix &X)
+    {
+        //Matrix XX;
+        //Linalg::tcross_prod_lower(XX, datX);
+        MatrixXd XX(XXt(X));
+        MatOpSymLower<Double> op(XX);
+        Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, MatOpSymLower<Double> > eigs(&op, 1, 3);
+        srand(0);
+        eigs.init();
+        eigs.compute(100, 0.1);
+        Vector evals = eigs.eigenvalues();
+        return evals[0];
+    }
+
     ADMMLassoWide(ConstGenericMatrix &datX_, 
                   ConstGenericVector &datY_,
                   ArrayXd &penalty_factor_,
                   double eps_abs_ = 1e-6,
-                  double eps_rel_ = 1e-6) :
+                  double eps_rel_ = 1e-6,
+                  double sprad_ = -1.0) :
         ADMMBase<Eigen::SparseVector<double>, Eigen::VectorXd, Eigen::VectorXd>
                  (datX_.cols(), datX_.rows(), datX_.rows(),
                  eps_abs_, eps_rel_),
         datX(datX_.data(), datX_.rows(), datX_.cols()),
         datY(datY_.data(), datY_.size()),
+        sprad(sprad_),
         penalty_factor(penalty_factor_),
         lambda0((datX.transpose() * datY).cwiseAbs().maxCoeff()),
         cache_Ax(dim_dual), tmp(dim_dual)
     {
-        //Matrix XX;
-        //Linalg::tcross_prod_lower(XX, datX);
-        MatrixXd XX(XXt(datX));
-        MatOpSymLower<Double> op(XX);
-        Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, MatOpSymLower<Double> > eigs(&op, 1, 3);
-        srand(0);
-        eigs.init();
-        eigs.compute(100, 0.1);
-        Vector evals = eigs.eigenvalues();
-        sprad = evals[0];
+        // sprad_ > 0 is a spectral radius computed before for the same X
+        if(sprad <= 0)
+            sprad = spectral_radius(datX);
 
 #ifdef __AVX__
         vtrX.read_mat(datX);
@@ -252,7 +251,7 @@ public:
 
         iter_counter = 0;
 
-        rho_changed_action();
+        refactor();
     }
     // when computing for the next lambda, we can use the
     // current main_beta, aux_gamma, dual_nu and rho as initial values
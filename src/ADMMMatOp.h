@@ -71,4 +71,52 @@ public:
 };
 
 
+// X'X with columns scaled to unit norm, i.e. D^{-1/2} X'X D^{-1/2}
+// with D = diag(X'X). For wide X the nonzero eigenvalues are
+// obtained from the smaller matrix X D^{-1} X' instead
+template <typename Scalar>
+class MatOpXXNormalized
+{
+private:
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Map<const Matrix> MapMat;
+    typedef Eigen::Map< Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > MapVec;
+    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
+    typedef const Eigen::Ref<const Vector> ConstGenericVector;
+
+    const MapMat mat;
+    Vector inv_norm;           // 1 / ||X_j||
+    const bool is_wide;
+    const int dim;
+
+public:
+    MatOpXXNormalized(ConstGenericMatrix &mat_, ConstGenericVector &colsq_) :
+        mat(mat_.data(), mat_.rows(), mat_.cols()),
+        inv_norm(colsq_.cwiseSqrt().cwiseInverse()),
+        is_wide(mat.cols() > mat.rows()),
+        dim(std::min(mat.rows(), mat.cols()))
+    {}
+
+    int rows() { return dim; }
+    int cols() { return dim; }
+
+    // y_out = A * x_in
+    void perform_op(Scalar *x_in, Scalar *y_out)
+    {
+        MapVec x(x_in, dim);
+        MapVec y(y_out, dim);
+
+        if(is_wide)
+        {
+            Vector tmp = (mat.transpose() * x).cwiseProduct(inv_norm.cwiseAbs2());
+            y.noalias() = mat * tmp;
+        } else {
+            Vector tmp = mat * x.cwiseProduct(inv_norm);
+            y.noalias() = (mat.transpose() * tmp).cwiseProduct(inv_norm);
+        }
+    }
+};
+
+
 #endif // ADMMMATOP_H
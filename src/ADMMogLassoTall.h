@@ -6,9 +6,7 @@
 #include "Spectra/SymEigsSolver.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
-
-using Rcpp::IntegerVector;
-using Rcpp::CharacterVector;
+#include <string>
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
 //
@@ -56,8 +54,8 @@ protected:
     VectorXd Cbeta;               // C * beta
     VectorXd savedEigs;           // saved eigenvalues
     VectorXd group_weights;       // group weight multipliers
-    CharacterVector family;       // model family (gaussian, binomial, or Cox PH)
-    IntegerVector group_idx;      // indices of groups
+    std::string family;           // model family (gaussian, binomial, or Cox PH)
+    VectorXi group_idx;           // indices of groups
     
     LLT solver;                   // matrix factorization
     double newton_tol;            // tolerance for newton iterations
@@ -204,9 +202,9 @@ public:
                      const SpMatR &C_,// const VectorXd &D_, 
                      int nobs_, int nvars_, int M_,
                      int ngroups_,
-                     Rcpp::CharacterVector family_,
+                     const std::string &family_,
                      VectorXd group_weights_,
-                     Rcpp::IntegerVector group_idx_,
+                     const VectorXi &group_idx_,
                      bool dynamic_rho_,
                      double newton_tol_ = 1e-5,
                      int newton_maxit_ = 100,
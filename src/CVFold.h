@@ -0,0 +1,252 @@
+#ifndef CVFOLD_H
+#define CVFOLD_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+#include <stdexcept>
+#include "DataStd.h"
+
+// sufficient statistics for cross-validation without copying the
+// training rows of each fold. the rows of X are stored once, ordered
+// by fold, and the statistics of the training rows of a fold
+// (column sums, X'y, X'X, ...) are those of the full data minus those
+// of the held-out rows, which are contiguous.
+
+// columns of a p x p Gram matrix, computed lazily the first time they
+// are requested and shared by all the threads that fit the folds
+class SharedColumns
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    
+    std::vector<Vector> cols;
+    std::vector<int> done;
+
+protected:
+    virtual void compute_col(int j, Vector &res) = 0;
+
+public:
+    SharedColumns(int p_) : cols(p_), done(p_, 0) {}
+    
+    virtual ~SharedColumns() {}
+    
+    // the flag is read and written with sequentially consistent
+    // atomics, so a thread that sees it set also sees the column
+    const Vector &col(int j)
+    {
+        int ready;
+        #pragma omp atomic read seq_cst
+        ready = done[j];
+        
+        if (!ready)
+        {
+            // several threads may compute the same column,
+            // but only the first result is stored
+            Vector res;
+            compute_col(j, res);
+            #pragma omp critical(shared_columns)
+            {
+                if (!done[j])
+                {
+                    cols[j].swap(res);
+                    #pragma omp atomic write seq_cst
+                    done[j] = 1;
+                }
+            }
+        }
+        return cols[j];
+    }
+};
+
+// X'X of the full (fold ordered) data
+class FullGram: public SharedColumns
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    
+    const Matrix &datX;
+    
+    void compute_col(int j, Vector &res)
+    {
+        res.noalias() = datX.transpose() * datX.col(j);
+    }
+
+public:
+    FullGram(const Matrix &datX_) : SharedColumns(datX_.cols()), datX(datX_) {}
+};
+
+// standardized sufficient statistics of the training rows of one fold,
+// i.e. all rows except the held-out rows start, ..., start + nhold - 1
+class CVFold: public SharedColumns
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Array<double, Eigen::Dynamic, 1> Array;
+    
+    const Matrix &datX;
+    FullGram *gram;               // X'X over all rows, NULL if the columns are not used
+    const int start;
+    const int nhold;
+    const bool centre;            // whether the columns are centred
+    
+    Array meanX;                  // centre and scale of the training columns
+    Array scaleX;
+    
+    // X'X of the standardized training rows, from
+    // X'X - Xh'Xh - m * meanX * meanX'
+    void compute_col(int j, Vector &res)
+    {
+        if (gram == NULL)
+            throw std::logic_error("the columns of X'X of a fold need the X'X of all rows");
+        const int m = nobs;
+        res.noalias() = -(datX.middleRows(start, nhold).transpose() * datX.middleRows(start, nhold).col(j));
+        res += gram->col(j);
+        res.array() = (res.array() - m * meanX(j) * meanX) / (scaleX(j) * scaleX);
+    }
+
+public:
+    const int nobs;               // number of training rows
+    DataStd<double> datstd;       // standardization of the training rows
+    Vector XY;                    // standardized X'y
+    Vector Xsq;                   // standardized colSums(X^2)
+    double yy;                    // standardized y'y
+    double null_dev;              // residual sum of squares of the intercept-only model
+    
+    // colsum_X, colsumsq_X, XY_full, sum_Y and sumsq_Y are
+    // the statistics of the raw data over all rows
+    CVFold(const Matrix &datX_, const Vector &datY, FullGram *gram_,
+           int start_, int nhold_,
+           const Array &colsum_X, const Array &colsumsq_X, const Vector &XY_full,
+           double sum_Y, double sumsq_Y,
+           bool standardize, bool intercept) :
+        SharedColumns(datX_.cols()),
+        datX(datX_), gram(gram_),
+        start(start_), nhold(nhold_), centre(intercept),
+        meanX(datX_.cols()), scaleX(datX_.cols()),
+        nobs(datX_.rows() - nhold_),
+        datstd(datX_.rows() - nhold_, datX_.cols(), standardize, intercept)
+    {
+        const int p = datX.cols();
+        const double m = nobs;
+        Eigen::Block<const Matrix> Xh = datX.middleRows(start, nhold);
+        Eigen::VectorBlock<const Vector> Yh = datY.segment(start, nhold);
+        
+        Array sx  = colsum_X - Xh.colwise().sum().transpose().array();
+        Array sxx = colsumsq_X - Xh.array().square().colwise().sum().transpose();
+        Vector xy = XY_full - Xh.transpose() * Yh;
+        double sy  = sum_Y - Yh.sum();
+        double syy = sumsq_Y - Yh.squaredNorm();
+        
+        datstd.set_moments(sx, sxx, sy, syy);
+        for (int j = 0; j < p; j++)
+        {
+            meanX(j) = datstd.get_meanX(j);
+            scaleX(j) = datstd.get_scaleX(j);
+        }
+        const double meanY = datstd.get_meanY();
+        const double scaleY = datstd.get_scaleY();
+        
+        XY = ((xy.array() - m * meanY * meanX) / (scaleX * scaleY)).matrix();
+        Xsq = ((sxx - m * meanX.square()) / scaleX.square()).matrix();
+        yy = (syy - m * meanY * meanY) / (scaleY * scaleY);
+        double ysum = (sy - m * meanY) / scaleY;
+        null_dev = yy - ysum * ysum / m;
+    }
+    
+    // U such that the (centred, unscaled) X'X of the training rows
+    // is X'X - U * U', i.e. the held-out rows and sqrt(m) * meanX
+    Matrix downdate_vectors() const
+    {
+        Matrix U(datX.cols(), nhold + int(centre));
+        U.leftCols(nhold) = datX.middleRows(start, nhold).transpose();
+        if (centre)
+            U.col(nhold) = std::sqrt(double(nobs)) * meanX.matrix();
+        return U;
+    }
+    
+    // lower triangle of the standardized X'X of the training rows,
+    // given the lower triangle of X'X over all rows
+    void gram_lower(const Matrix &XX_full, Matrix &res) const
+    {
+        res = XX_full;
+        res.selfadjointView<Eigen::Lower>().rankUpdate(downdate_vectors(), -1.0);
+        res.array().colwise() /= scaleX;
+        res.array().rowwise() /= scaleX.transpose();
+    }
+    
+    // out-of-fold predictions X_h * coef + beta0
+    // for coefficients on the original scale
+    void predict(const Vector &coef, double beta0, double *res)
+    {
+        Eigen::Map<Vector> pred(res, nhold);
+        pred.noalias() = datX.middleRows(start, nhold) * coef;
+        pred.array() += beta0;
+    }
+};
+
+
+// orders the rows by fold, foldid[i] in 1, ..., nfolds. order[r] is the
+// original index of row r, and the rows of fold k (0-based) are
+// fold_start[k], ..., fold_start[k + 1] - 1. returns nfolds, and throws
+// if a fold id is below 1 (including NA)
+inline int fold_order(const int *foldid, int n, std::vector<int> &order, std::vector<int> &fold_start)
+{
+    int nfolds = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (foldid[i] < 1)
+            throw std::invalid_argument("foldid must hold integers between 1 and nfolds");
+        nfolds = std::max(nfolds, foldid[i]);
+    }
+    
+    fold_start.assign(nfolds + 1, 0);
+    for (int i = 0; i < n; i++)
+        fold_start[foldid[i]]++;
+    for (int k = 0; k < nfolds; k++)
+        fold_start[k + 1] += fold_start[k];
+    
+    order.resize(n);
+    std::vector<int> pos(fold_start.begin(), fold_start.end() - 1);
+    for (int i = 0; i < n; i++)
+        order[pos[foldid[i] - 1]++] = i;
+    
+    return nfolds;
+}
+
+// the folds of the fold ordered data datX and datY. the
+// statistics of the full data are computed once here. the columns of
+// X'X of the folds (SharedColumns::col()) come from gram, and are not
+// available if it is NULL
+inline void make_folds(const Eigen::MatrixXd &datX, const Eigen::VectorXd &datY, FullGram *gram,
+                       const std::vector<int> &fold_start, bool standardize, bool intercept,
+                       std::vector<CVFold*> &folds)
+{
+    Eigen::ArrayXd colsum_X = datX.colwise().sum().transpose();
+    Eigen::ArrayXd colsumsq_X = datX.array().square().colwise().sum().transpose();
+    Eigen::VectorXd XY_full = datX.transpose() * datY;
+    const double sum_Y = datY.sum();
+    const double sumsq_Y = datY.squaredNorm();
+    
+    const int nfolds = fold_start.size() - 1;
+    folds.resize(nfolds);
+    for (int k = 0; k < nfolds; k++)
+        folds[k] = new CVFold(datX, datY, gram, fold_start[k], fold_start[k + 1] - fold_start[k],
+                              colsum_X, colsumsq_X, XY_full, sum_Y, sumsq_Y,
+                              standardize, intercept);
+}
+
+// the folds for the solvers that only use their X'X through
+// CVFold::gram_lower(), e.g. ADMMLassoTallCV
+inline void make_folds(const Eigen::MatrixXd &datX, const Eigen::VectorXd &datY,
+                       const std::vector<int> &fold_start, bool standardize, bool intercept,
+                       std::vector<CVFold*> &folds)
+{
+    make_folds(datX, datY, NULL, fold_start, standardize, intercept, folds);
+}
+
+
+
+#endif // CVFOLD_H
@@ -0,0 +1,434 @@
+#ifndef CONSENSUSTRANSPORT_H
+#define CONSENSUSTRANSPORT_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <new>
+#include <stdexcept>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+// The exchange between the master and the workers of a consensus ADMM
+// (PADMMBase.h), independent of where the workers run. Each round, the
+// master writes z into a buffer that the workers read in place (no copy
+// per worker), publishes a command by advancing a round counter, and
+// the workers answer in their own slots with x_i + y_i / rho and three
+// sums of squares. The master adds the slots up in the order the workers
+// finish, so the reduction overlaps the updates of the slower workers.
+//
+// The buffer and the counters are one block of memory, which is ordinary
+// memory shared by threads (ConsensusThreads) or a shared mapping between
+// processes (ConsensusProcesses). A transport between hosts only needs to
+// move z and the slots, the workers and the master do not change.
+
+// the worker side of the exchange
+class ConsensusEndpoint
+{
+public:
+    virtual ~ConsensusEndpoint() {}
+
+    // cold start with rho, x_i = y_i = 0
+    virtual void init(double rho) = 0;
+    // y_i update with z (unless a cold start precedes), then x_i update with z
+    virtual void step(const double *z, bool update_dual) = 0;
+    // xu = x_i + y_i / rho, stats = ||x_i||^2, ||y_i||^2, ||x_i - z||^2
+    virtual void result(double *xu, double *stats) = 0;
+    // res = A_i'A_i * v
+    virtual void multiply(const double *v, double *res) = 0;
+};
+
+// builds the workers where they run, which places their data in memory
+// local to the thread or process that owns them (first touch)
+class ConsensusFactory
+{
+public:
+    virtual ~ConsensusFactory() {}
+
+    virtual ConsensusEndpoint *make(int i) = 0;
+    // the data the workers were built from is no longer needed, called
+    // once all the workers exist, and in each worker process after make()
+    virtual void release() {}
+};
+
+
+class ConsensusTransport
+{
+public:
+    enum Command { CMD_INIT = 1, CMD_STEP, CMD_MULT, CMD_STOP };
+
+protected:
+    typedef std::atomic<long long> Counter;
+
+    // the header and the slot counters are on their own cache lines,
+    // which the workers do not write to at the same time
+    static const size_t line = 64;
+    struct Header
+    {
+        Counter round;         // the last published round
+        Counter error;         // a worker has failed
+        int command;
+        double rho;
+    };
+    struct Slot
+    {
+        Counter done;          // the last round answered, -1 until the worker exists
+        double stats[3];
+    };
+
+    const int n_comp;
+    const int dim;
+    const size_t stride;       // doubles between two xu slots
+    long long round;
+
+    char *mem;
+    Header *header;
+    double *zbuf;
+
+    static size_t align(size_t bytes) { return (bytes + line - 1) / line * line; }
+
+    Slot *slot(int i) { return reinterpret_cast<Slot *>(mem + align(sizeof(Header)) + i * align(sizeof(Slot))); }
+    double *xu(int i) { return zbuf + (i + 1) * stride; }
+
+    // bytes needed for n workers and vectors of length p
+    static size_t bytes(int n, int p)
+    {
+        return align(sizeof(Header)) + n * align(sizeof(Slot)) +
+               (n + 1) * align(p * sizeof(double));
+    }
+
+    ConsensusTransport(int n_comp_, int dim_) :
+        n_comp(n_comp_), dim(dim_),
+        stride(align(dim_ * sizeof(double)) / sizeof(double)),
+        round(0), mem(NULL), header(NULL), zbuf(NULL)
+    {}
+
+    // places the header, the slots and the buffers in mem_
+    void attach(void *mem_)
+    {
+        mem = static_cast<char *>(mem_);
+        header = new (mem) Header;
+        header->round.store(0);
+        header->error.store(0);
+        for(int i = 0; i < n_comp; i++)
+            new (slot(i)) Slot;
+        for(int i = 0; i < n_comp; i++)
+            slot(i)->done.store(-1);
+        zbuf = reinterpret_cast<double *>(mem + align(sizeof(Header)) + n_comp * align(sizeof(Slot)));
+    }
+
+    // a worker process has died, seen by the master
+    virtual bool lost() { return false; }
+    // the master process has died, seen by a worker
+    virtual bool abandoned() { return false; }
+
+    void wait_done(int i, long long r)
+    {
+        for(int spins = 0; slot(i)->done.load(std::memory_order_acquire) < r; spins++)
+        {
+            if(spins > 1000)
+            {
+                if(header->error.load() || lost())
+                    throw std::runtime_error("a worker of the parallel ADMM failed");
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // the loop of worker i, until CMD_STOP
+    void serve(int i, ConsensusFactory &factory)
+    {
+        ConsensusEndpoint *worker = NULL;
+        try {
+            worker = factory.make(i);
+            slot(i)->done.store(0, std::memory_order_release);
+
+            long long seen = 0;
+            for(;;)
+            {
+                long long r;
+                for(int spins = 0; (r = header->round.load(std::memory_order_acquire)) <= seen; spins++)
+                {
+                    if(spins > 1000)
+                    {
+                        if(abandoned())
+                            throw std::runtime_error("the master of the parallel ADMM is gone");
+                        std::this_thread::yield();
+                    }
+                }
+                seen = r;
+
+                const int command = header->command;
+                if(command == CMD_STOP)
+                    break;
+
+                switch(command)
+                {
+                    case CMD_INIT:
+                        worker->init(header->rho);
+                        worker->step(zbuf, false);
+                        break;
+                    case CMD_STEP:
+                        worker->step(zbuf, true);
+                        break;
+                    case CMD_MULT:
+                        worker->multiply(zbuf, xu(i));
+                        break;
+                }
+                if(command != CMD_MULT)
+                    worker->result(xu(i), slot(i)->stats);
+
+                slot(i)->done.store(r, std::memory_order_release);
+            }
+        } catch(...) {
+            header->error.store(1);
+        }
+        delete worker;
+    }
+
+    // waits for all the workers to exist
+    void wait_ready()
+    {
+        for(int i = 0; i < n_comp; i++)
+            wait_done(i, 0);
+    }
+
+    // the workers see CMD_STOP at their next round
+    void stop()
+    {
+        if(header == NULL)
+            return;
+        header->command = CMD_STOP;
+        header->round.store(++round, std::memory_order_release);
+    }
+
+public:
+    virtual ~ConsensusTransport() {}
+
+    int size() const { return n_comp; }
+
+    // z, or the vector of CMD_MULT, written by the master before
+    // broadcast() and read in place by the workers
+    double *z() { return zbuf; }
+
+    // starts a round of command on all the workers
+    void broadcast(int command, double rho)
+    {
+        header->command = command;
+        header->rho = rho;
+        header->round.store(++round, std::memory_order_release);
+    }
+
+    // sum = \sum_i xu_i, stats = \sum_i stats_i for the last round,
+    // each worker added as soon as it has answered
+    void reduce(Eigen::VectorXd &sum, double *stats)
+    {
+        sum.setZero(dim);
+        stats[0] = stats[1] = stats[2] = 0.0;
+
+        std::vector<int> pending(n_comp);
+        for(int i = 0; i < n_comp; i++)
+            pending[i] = i;
+
+        for(int spins = 0; !pending.empty(); spins++)
+        {
+            for(size_t k = 0; k < pending.size(); )
+            {
+                const int i = pending[k];
+                if(slot(i)->done.load(std::memory_order_acquire) < round)
+                {
+                    k++;
+                    continue;
+                }
+
+                sum += Eigen::Map<const Eigen::VectorXd>(xu(i), dim);
+                for(int j = 0; j < 3; j++)
+                    stats[j] += slot(i)->stats[j];
+                pending[k] = pending.back();
+                pending.pop_back();
+                spins = 0;
+            }
+
+            if(spins > 1000)
+            {
+                if(header->error.load() || lost())
+                    throw std::runtime_error("a worker of the parallel ADMM failed");
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+
+// workers on threads of this process
+class ConsensusThreads: public ConsensusTransport
+{
+private:
+    std::vector<char> buffer;
+    std::vector<std::thread> threads;
+
+public:
+    ConsensusThreads(int n_comp_, int dim_, ConsensusFactory &factory) :
+        ConsensusTransport(n_comp_, dim_),
+        buffer(bytes(n_comp_, dim_) + line)
+    {
+        char *base = &buffer[0];
+        const size_t addr = reinterpret_cast<size_t>(base);
+        attach(base + (align(addr) - addr));
+
+        for(int i = 0; i < n_comp; i++)
+            threads.push_back(std::thread(&ConsensusThreads::serve, this, i, std::ref(factory)));
+
+        try {
+            wait_ready();
+        } catch(...) {
+            stop();
+            for(int i = 0; i < n_comp; i++)
+                threads[i].join();
+            throw;
+        }
+        factory.release();
+    }
+
+    ~ConsensusThreads()
+    {
+        stop();
+        for(int i = 0; i < n_comp; i++)
+            threads[i].join();
+    }
+};
+
+
+// workers in child processes of this one, which share an anonymous
+// mapping with it. the children are forked after the data is in place,
+// so each reads its block from the copy-on-write pages of the parent,
+// copies it and drops the rest. they run no R code, and exit without
+// returning into the caller
+class ConsensusProcesses: public ConsensusTransport
+{
+private:
+    size_t len;
+    std::vector<int> children;   // pids, -1 once reaped
+    int parent;
+
+    bool lost()
+    {
+#ifdef _WIN32
+        return false;
+#else
+        for(int i = 0; i < n_comp; i++)
+        {
+            if(children[i] > 0 && waitpid(children[i], NULL, WNOHANG) == children[i])
+            {
+                children[i] = -1;
+                return true;
+            }
+        }
+        return false;
+#endif
+    }
+
+    bool abandoned()
+    {
+#ifdef _WIN32
+        return false;
+#else
+        return getppid() != parent;
+#endif
+    }
+
+    void serve_child(int i, ConsensusFactory &factory)
+    {
+#ifndef _WIN32
+        // the child drops its view of the data once it has its block
+        struct Releasing: public ConsensusFactory
+        {
+            ConsensusFactory &base;
+            Releasing(ConsensusFactory &base_) : base(base_) {}
+            ConsensusEndpoint *make(int i)
+            {
+                ConsensusEndpoint *res = base.make(i);
+                base.release();
+                return res;
+            }
+        } releasing(factory);
+
+        serve(i, releasing);
+        _exit(header->error.load() ? 1 : 0);
+#endif
+    }
+
+    void shutdown()
+    {
+#ifndef _WIN32
+        stop();
+        for(int i = 0; i < n_comp; i++)
+        {
+            if(children[i] > 0)
+                waitpid(children[i], NULL, 0);
+        }
+        munmap(mem, len);
+#endif
+    }
+
+public:
+    ConsensusProcesses(int n_comp_, int dim_, ConsensusFactory &factory) :
+        ConsensusTransport(n_comp_, dim_),
+        len(bytes(n_comp_, dim_)),
+        children(n_comp_, -1),
+        parent(-1)
+    {
+#ifdef _WIN32
+        throw std::runtime_error("worker processes are not supported on Windows");
+#else
+        void *addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if(addr == MAP_FAILED)
+            throw std::runtime_error("cannot map the memory shared with the worker processes");
+        attach(addr);
+
+        parent = getpid();
+        for(int i = 0; i < n_comp; i++)
+        {
+            const int pid = fork();
+            if(pid == 0)
+                serve_child(i, factory);
+            if(pid < 0)
+            {
+                header->error.store(1);
+                shutdown();
+                throw std::runtime_error("cannot start the worker processes");
+            }
+            children[i] = pid;
+        }
+
+        try {
+            wait_ready();
+        } catch(...) {
+            for(int i = 0; i < n_comp; i++)
+            {
+                if(children[i] > 0)
+                    kill(children[i], SIGKILL);
+            }
+            shutdown();
+            throw;
+        }
+        factory.release();
+#endif
+    }
+
+    ~ConsensusProcesses()
+    {
+        shutdown();
+    }
+
+};
+
+
+#endif // CONSENSUSTRANSPORT_H
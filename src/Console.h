@@ -0,0 +1,23 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <ostream>
+#include <iomanip>
+
+// the stream the solvers print their debugging output to. nothing is
+// printed until it is set: the R entry points set it to the R console
+// (RcppBinding.h), and programs linking the solvers directly to any
+// std::ostream of their own
+inline std::ostream *&console_stream()
+{
+    static std::ostream discard(NULL);
+    static std::ostream *stream = &discard;
+    return stream;
+}
+
+inline std::ostream &console() { return *console_stream(); }
+
+inline void set_console(std::ostream &stream) { console_stream() = &stream; }
+
+
+#endif // CONSOLE_H
@@ -1,9 +1,12 @@
 #ifndef COORDBASE_H
 #define COORDBASE_H
 
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "Console.h"
 #include "Linalg/BlasWrapper.h"
 #include "utils.h"
+#include "Deadline.h"
 
 
 template<typename VecTypeX>
@@ -19,33 +22,113 @@ protected:
     
     double tol;           // tolerance for convergence
     
+    bool active_set;          // cycle over the active set between full sweeps
+    std::vector<int> active;  // indices of coefficients that have ever been nonzero
+    std::vector<bool> in_active;
+    
+    SolveDeadline *deadline;  // time budget and interruption, NULL if none
+    
+    // res = beta after a full sweep over all coordinates
     virtual void next_beta(VecTypeX &res) = 0;
+    // res = beta after a sweep over the coordinates in the active set only
+    virtual void next_beta_active(VecTypeX &res) = 0;
     
     virtual bool converged()
     {
         return (stopRule(beta, beta_prev, tol));
     }
     
+    // called before every sweep. the default convergence check
+    // compares against the previous beta, solvers that track
+    // convergence incrementally can skip the copy
+    virtual void start_sweep()
+    {
+        beta_prev = beta;
+    }
+    
+    // add the coefficients that became nonzero to the active set.
+    // as in glmnet, variables are never removed, so that variables
+    // that enter and leave repeatedly do not trigger full sweeps.
+    // returns true if the active set has grown
+    bool update_active_set()
+    {
+        bool changed = false;
+        for (int j = 0; j < nvars; ++j)
+        {
+            if (beta(j) != 0 && !in_active[j])
+            {
+                in_active[j] = true;
+                active.push_back(j);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+    
+    // glmnet-style active set cycling. a full sweep determines the
+    // active set, then we iterate over the active set only until
+    // convergence and do another full sweep to check the KKT
+    // conditions. we stop once a full sweep converges without changing
+    // the support. each sweep (active or full) counts as one iteration
+    int solve_active_set(int maxit)
+    {
+        int i = 0;
+        
+        while (i < maxit)
+        {
+            start_sweep();
+            update_beta();
+            ++i;
+            
+            bool support_changed = update_active_set();
+            
+            if (converged() && !support_changed)
+                break;
+            if (deadline && deadline->expired())
+                break;
+            
+            while (i < maxit)
+            {
+                start_sweep();
+                next_beta_active(beta);
+                ++i;
+                
+                if (converged())
+                    break;
+                if (deadline && deadline->expired())
+                    break;
+            }
+            
+            if (deadline && deadline->stopped())
+                break;
+        }
+        
+        return i;
+    }
     
     void print_row(int iter)
     {
         const char sep = ' ';
         
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << iter;
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << iter;
+        console() << std::endl;
     }
     void print_footer()
     {
         const int width = 80;
-        Rcpp::Rcout << std::string(width, '=') << std::endl << std::endl;
+        console() << std::string(width, '=') << std::endl << std::endl;
     }
     
 public:
     CoordBase(int n_, int p_,
-              double tol_ = 1e-6) :
+              double tol_ = 1e-6,
+              bool active_set_ = false) :
     nvars(p_), nobs(n_),
     beta(p_), beta_prev(p_), // allocate space but do not set values
-    tol(tol_)
+    tol(tol_),
+    active_set(active_set_),
+    in_active(p_, false),
+    deadline(NULL)
     {}
     
     virtual ~CoordBase() {}
@@ -59,11 +142,14 @@ public:
     
     int solve(int maxit)
     {
+        if (active_set)
+            return solve_active_set(maxit);
+        
         int i;
         
         for(i = 0; i < maxit; ++i)
         {
-            beta_prev = beta;
+            start_sweep();
             // old_y = dual_y;
             //std::copy(dual_y.data(), dual_y.data() + dim_dual, old_y.data());
             
@@ -74,6 +160,8 @@ public:
             if(converged())
                 break;
             
+            if(deadline && deadline->expired())
+                break;
         }
         
         // print_footer();
@@ -81,9 +169,58 @@ public:
         return i + 1;
     }
     
+    // stops the following fits after the sweep in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+    
     virtual VecTypeX get_beta() { return beta; }
 };
 
+// the sweep bookkeeping shared by the coordinate descent engines. an
+// engine provides the member template sweep<Weighted>(idx, count), which
+// updates the coordinates idx[0], ..., idx[count - 1], with Weighted =
+// true if penalty factors are used, and implements next_beta() and
+// next_beta_active() with run_sweep(), which makes that choice once per
+// sweep. max_change is reset before every sweep, the engines define
+// what it measures
+class CoordSweep: public CoordBase<Eigen::VectorXd>
+{
+protected:
+    const bool weighted;      // whether penalty factors are used
+    double max_change;        // largest change in the current sweep
+    
+    // index sequence 0, 1, ..., p - 1 for full sweeps
+    struct AllCoords
+    {
+        int operator[](int k) const { return k; }
+    };
+    
+    // engine.sweep<weighted>(idx, count). the engine
+    // declares CoordSweep a friend if sweep() is not public
+    template<typename Engine, typename Index>
+    void run_sweep(Engine &engine, const Index &idx, int count)
+    {
+        if (weighted)
+            engine.template sweep<true>(idx, count);
+        else
+            engine.template sweep<false>(idx, count);
+    }
+    
+    // the engines track convergence incrementally,
+    // so there is no need to keep a copy of beta
+    void start_sweep()
+    {
+        max_change = 0;
+    }
+
+public:
+    CoordSweep(int n_, int p_, bool weighted_,
+               double tol_ = 1e-6,
+               bool active_set_ = false) :
+    CoordBase<Eigen::VectorXd>(n_, p_, tol_, active_set_),
+    weighted(weighted_),
+    max_change(0)
+    {}
+};
 
 
 #endif // COORDBASE_H
@@ -0,0 +1,36 @@
+#ifndef COORDCV_H
+#define COORDCV_H
+
+#include "CoordMCP.h"
+#include "CVFold.h"
+
+// coordinate descent on the training rows of a cross-validation
+// fold, from the statistics in CVFold.h
+
+// concave penalized solver for the training rows of a fold
+template<typename Penalty>
+class CoordConcaveCV: public CoordConcave<Penalty>
+{
+private:
+    typedef typename CoordConcave<Penalty>::Vector Vector;
+    
+    CVFold &fold;
+    
+    const Vector &get_xx_col(int j)
+    {
+        return fold.col(j);
+    }
+
+public:
+    CoordConcaveCV(CVFold &fold_, ArrayXd &penalty_factor_,
+                   double tol_ = 1e-6, bool active_set_ = false) :
+    CoordConcave<Penalty>(fold_.nobs, fold_.XY.size(),
+                          fold_.XY, fold_.Xsq, fold_.yy, fold_.null_dev,
+                          penalty_factor_, tol_, active_set_),
+    fold(fold_)
+    {}
+};
+
+
+
+#endif // COORDCV_H
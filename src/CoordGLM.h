@@ -0,0 +1,282 @@
+#ifndef COORDGLM_H
+#define COORDGLM_H
+
+#include "CoordBase.h"
+#include "Linalg/Fused.h"
+#include "Penalty.h"
+
+// minimize  -loglik(beta0, beta) + sum_j pf_j * P_lambda(beta_j)
+//
+// for a generalized linear model with canonical link, by coordinate
+// descent on the IRLS quadratic approximation (as in glmnet). The
+// outer loop computes the working weights w = Var(mu) and the working
+// response z = eta + (y - mu) / w at the current fit, the inner loop
+// is coordinate descent on
+//
+//   1/2 * sum_i w_i * (z_i - beta0 - x_i'beta)^2 + penalty
+//
+// with the weighted residual r = w .* (z - eta) kept up to date.
+// The weights only change in the outer loop, so the weighted column
+// norms x_j'W x_j are computed the first time coordinate j is needed
+// after the weights change. A coordinate that is zero and stays zero
+// (|x_j'r| <= lambda_j) never needs its norm, so most columns are only
+// read once per sweep.
+
+// Family policies. mean() is the inverse link, variance() the IRLS
+// weight, start() the intercept of the starting fit and deviance()
+// the contribution of one observation
+struct FamilyBinomial
+{
+    // fitted probabilities are kept away from 0 and 1, as in glmnet,
+    // so the weights stay positive for separable data
+    static double mean(double eta)
+    {
+        const double eps = 1e-5;
+        double mu = 1.0 / (1.0 + std::exp(-eta));
+        return std::min(std::max(mu, eps), 1.0 - eps);
+    }
+    
+    static double variance(double mu) { return mu * (1.0 - mu); }
+    
+    static double link(double mu) { return std::log(mu / (1.0 - mu)); }
+    
+    // starting intercept for the mean response ybar, finite
+    // for a constant response
+    static double start(double ybar)
+    {
+        const double eps = 1e-5;
+        return link(std::min(std::max(ybar, eps), 1.0 - eps));
+    }
+    
+    static double deviance(double y, double mu)
+    {
+        return -2.0 * (y * std::log(mu) + (1.0 - y) * std::log(1.0 - mu));
+    }
+};
+
+struct FamilyPoisson
+{
+    static double mean(double eta) { return std::exp(eta); }
+    
+    static double variance(double mu) { return mu; }
+    
+    static double link(double mu) { return std::log(mu); }
+    
+    static double start(double ybar) { return link(std::max(ybar, 1e-5)); }
+    
+    static double deviance(double y, double mu)
+    {
+        double res = mu - y;
+        if (y > 0)
+            res += y * std::log(y / mu);
+        return 2.0 * res;
+    }
+};
+
+// the zero test in the sweeps assumes that the thresholding of the
+// penalty is zero exactly when |z| <= pen, which holds for the L1, MCP
+// and SCAD policies (not for PenaltyEnet with alpha < 1)
+template<typename Penalty, typename Family>
+class CoordGLM: public CoordSweep
+{
+protected:
+    friend class CoordSweep;
+    
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Map<const Matrix> MapMat;
+    typedef Eigen::Map<const Vector> MapVec;
+    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
+    typedef const Eigen::Ref<const Vector> ConstGenericVector;
+    
+    MapMat datX;                  // data matrix
+    MapVec datY;                  // response vector
+    
+    bool intercept;               // whether beta0 is fitted
+    double beta0;                 // intercept, not penalized
+    
+    double lambda;                // penalty parameter
+    double lambda0;               // minimum lambda to make coefficients all zero
+    Penalty pen;                  // penalty policy and its parameters
+    
+    ArrayXd penalty_factor;       // penalty multiplication factors
+    
+    Vector eta;                   // linear predictor at the last outer step
+    Vector weights;               // IRLS weights
+    double weights_sum;
+    Vector resid_cur;             // weighted working residual w .* (z - beta0 - X * beta)
+    
+    Vector xwx;                   // x_j'W x_j for the current weights
+    std::vector<int> xwx_stamp;   // outer step at which xwx(j) was computed
+    int outer;                    // number of weight updates so far
+    
+    double null_dev;              // deviance of the intercept-only model
+    double dev;                   // deviance at the last outer step
+    
+    int irls_maxit;               // maximum number of outer steps per lambda
+    double irls_tol;              // outer steps stop when the deviance changes by less than irls_tol * null_dev
+    
+    // x_j'W x_j, computed once per outer step
+    double weighted_norm(int j)
+    {
+        if (xwx_stamp[j] != outer)
+        {
+            xwx(j) = (datX.col(j).array().square() * weights.array()).sum();
+            xwx_stamp[j] = outer;
+        }
+        return xwx(j);
+    }
+    
+    // IRLS step: weights and working residual at the current beta.
+    // eta is computed from the nonzero coefficients only
+    void update_weights()
+    {
+        eta.setConstant(beta0);
+        for (int j = 0; j < nvars; ++j)
+        {
+            if (beta(j) != 0)
+                eta.noalias() += beta(j) * datX.col(j);
+        }
+        
+        dev = 0;
+        for (int i = 0; i < nobs; ++i)
+        {
+            double mu = Family::mean(eta(i));
+            weights(i) = Family::variance(mu);
+            resid_cur(i) = datY(i) - mu;
+            dev += Family::deviance(datY(i), mu);
+        }
+        weights_sum = weights.sum();
+        ++outer;
+    }
+    
+    template<bool Weighted, typename Index>
+    void sweep(const Index &idx, int count)
+    {
+        double *r = resid_cur.data();
+        for (int k = 0; k < count; ++k)
+        {
+            const int j = idx[k];
+            const double lambda_j = Weighted ? penalty_factor(j) * lambda : lambda;
+            double xr = Linalg::dot(datX.col(j).data(), r, nobs);
+            
+            // the coordinate stays at zero
+            if (beta(j) == 0 && std::abs(xr) <= lambda_j)
+                continue;
+            
+            // lambda and gamma are on the scale of -loglik / n, so gamma
+            // is scaled by the curvature relative to a standardized column
+            const double a = weighted_norm(j);
+            double newval = pen.scaled(a / nobs).threshold(xr / a + beta(j), lambda_j / a);
+            double delta = newval - beta(j);
+            if (delta == 0)
+                continue;
+            
+            beta(j) = newval;
+            resid_cur.array() -= delta * weights.array() * datX.col(j).array();
+            max_change = std::max(max_change, a * delta * delta);
+        }
+        
+        if (intercept)
+        {
+            double delta = resid_cur.sum() / weights_sum;
+            beta0 += delta;
+            resid_cur.noalias() -= delta * weights;
+            max_change = std::max(max_change, weights_sum * delta * delta);
+        }
+    }
+    
+    void next_beta(Vector &res)
+    {
+        run_sweep(*this, AllCoords(), nvars);
+    }
+    
+    void next_beta_active(Vector &res)
+    {
+        run_sweep(*this, active, active.size());
+    }
+    
+    // glmnet stopping criterion for the inner loop. max_change
+    // is the largest x_j'W x_j * delta_j^2 in the sweep
+    bool converged()
+    {
+        return max_change <= tol * null_dev;
+    }
+
+public:
+    CoordGLM(ConstGenericMatrix &datX_,
+             ConstGenericVector &datY_,
+             ArrayXd &penalty_factor_,
+             bool intercept_,
+             double tol_ = 1e-7,
+             bool active_set_ = false,
+             int irls_maxit_ = 100,
+             double irls_tol_ = 1e-5) :
+    CoordSweep(datX_.rows(), datX_.cols(), penalty_factor_.size() > 0,
+               tol_, active_set_),
+              datX(datX_.data(), datX_.rows(), datX_.cols()),
+              datY(datY_.data(), datY_.size()),
+              intercept(intercept_),
+              penalty_factor(penalty_factor_),
+              eta(datX_.rows()),
+              weights(datX_.rows()),
+              resid_cur(datX_.rows()),
+              xwx(datX_.cols()),
+              xwx_stamp(datX_.cols(), -1),
+              outer(0),
+              irls_maxit(irls_maxit_),
+              irls_tol(irls_tol_)
+    {
+        // the intercept-only (or empty) model, at which lambda0 is
+        // the largest |x_j'(y - mu)|
+        beta.setZero();
+        beta0 = intercept ? Family::start(datY.mean()) : 0.0;
+        update_weights();
+        null_dev = dev;
+        lambda0 = (datX.transpose() * resid_cur).cwiseAbs().maxCoeff();
+    }
+    
+    double get_lambda_zero() const { return lambda0; }
+    
+    void set_penalty(const Penalty &pen_) { pen = pen_; }
+    
+    // init() is a cold start for the first lambda
+    void init(double lambda_)
+    {
+        beta.setZero();
+        beta0 = intercept ? Family::start(datY.mean()) : 0.0;
+        lambda = lambda_;
+    }
+    // warm start from the solution for the previous lambda
+    void init_warm(double lambda_)
+    {
+        lambda = lambda_;
+    }
+    
+    // outer IRLS loop around the inner coordinate descent. every
+    // sweep counts as one iteration, maxit bounds the total
+    int solve(int maxit)
+    {
+        int iter = 0;
+        for (int k = 0; k < irls_maxit && iter < maxit; ++k)
+        {
+            double dev_prev = dev;
+            update_weights();
+            if (k > 0 && std::abs(dev - dev_prev) < irls_tol * null_dev)
+                break;
+            
+            iter += CoordSweep::solve(maxit - iter);
+            if (deadline && deadline->stopped())
+                break;
+        }
+        return iter;
+    }
+    
+    double get_intercept() const { return beta0; }
+    double get_deviance() const { return dev; }
+    double get_null_deviance() const { return null_dev; }
+};
+
+
+
+#endif // COORDGLM_H
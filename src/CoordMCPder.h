@@ -3,8 +3,10 @@
 
 #include "CoordBase.h"
 #include "Linalg/BlasWrapper.h"
+#include "Linalg/Fused.h"
 #include "ADMMMatOp.h"
 #include "utils.h"
+#include "Penalty.h"
 
 // minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
 //
@@ -18,9 +20,11 @@
 // b => y
 // f(x) => 1/2 * ||Ax - b||^2
 // g(z) => lambda * ||z||_1
-class CoordMCPder: public CoordBase<Eigen::VectorXd> //Eigen::SparseVector<double>
+class CoordMCPder: public CoordSweep //Eigen::SparseVector<double>
 {
 protected:
+    friend class CoordSweep;
+    
     typedef float Scalar;
     typedef double Double;
     typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
@@ -48,7 +52,6 @@ protected:
     double objective;
     
     ArrayXd penalty_factor;       // penalty multiplication factors 
-    int penalty_factor_size;
     int num_loss;
     
     /*
@@ -69,34 +72,6 @@ protected:
     }
     */
     
-    static double soft_threshold(double &value, const double &penalty)
-    {
-        if(value > penalty)
-            return(value - penalty);
-        else if(value < -penalty)
-            return(value + penalty);
-        else 
-            return(0);
-    }
-    
-    static double soft_threshold_mcp(double &value, const double &penalty, double &gamma)
-    {
-        double absval = std::abs(value);
-        if (absval > penalty * gamma)
-        {
-            return(value);
-        } else if (value > penalty) 
-        {
-            return((value - penalty) / (1 - 1/gamma));
-        } else if (value < -penalty) 
-        {
-            return((value + penalty) / (1 - 1/gamma));
-        } else 
-        {
-            return(0);
-        }
-    }
-    
     void update_grad()
     {
         
@@ -121,48 +96,56 @@ protected:
         return (std::abs(objective_prev - objective) < null_dev * tol);
     }
     
-    void next_beta(Vector &res)
+    // threshold coordinate j given xr = x_j'r and return the change
+    // in beta_j. the residual is updated by the caller
+    double update_coord(int j, double penalty, double xr)
     {
+        double beta_prev = beta(j);
+        double grad = xr / Xsq(j) + beta_prev;
         
-        int j;
-        double grad;
-        // if no penalty multiplication factors specified
-        if (penalty_factor_size < 1) 
+        threshval = PenaltyMCP(gamma).threshold(grad, penalty / Xsq(j));
+        beta(j) = threshval;
+        return threshval - beta_prev;
+    }
+    
+    // update coordinates idx[0], ..., idx[count - 1]. only the first
+    // num_loss rows of X enter the sum of squares loss, so the residual
+    // has length num_loss. the residual update for one coordinate is
+    // fused with the inner product for the next
+    template<bool Weighted, typename Index>
+    void sweep(const Index &idx, int count)
+    {
+        if (count < 1)
+            return;
+        
+        double *r = resid_cur.data();
+        double xr = Linalg::dot(datX.col(idx[0]).data(), r, num_loss);
+        for (int k = 0; k < count; ++k)
         {
-            for (j = 0; j < nvars; ++j)
+            const int j = idx[k];
+            double delta = update_coord(j, Weighted ? penalty_factor(j) * lambda : lambda, xr);
+            if (k + 1 < count)
             {
-                double beta_prev = beta(j);
-                grad = datX.col(j).dot(resid_cur) / Xsq(j) + beta(j);
-                
-                threshval = soft_threshold_mcp(grad, lambda / Xsq(j), gamma);
-                
-                // update residual if the coefficient changes after
-                // thresholding. 
-                if (beta_prev != threshval)
-                {
-                    beta(j) = threshval;
-                    resid_cur -= (threshval - beta_prev) * datX.col(j);
-                }
-            }
-        } else //if penalty multiplication factors are used
-        {
-            for (j = 0; j < nvars; ++j)
+                const double *x_next = datX.col(idx[k + 1]).data();
+                if (delta != 0)
+                    xr = Linalg::axpy_dot(num_loss, -delta, datX.col(j).data(), r, x_next);
+                else
+                    xr = Linalg::dot(x_next, r, num_loss);
+            } else if (delta != 0)
             {
-                double beta_prev = beta(j);
-                grad = datX.col(j).head(num_loss).dot(resid_cur) / Xsq(j) + beta(j);
-                
-                threshval = soft_threshold_mcp(grad, penalty_factor(j) * lambda / Xsq(j), gamma);
-                
-                // update residual if the coefficient changes after
-                // thresholding. 
-                if (beta_prev != threshval)
-                {
-                    beta(j) = threshval;
-                    resid_cur -= (threshval - beta_prev) * datX.col(j).head(num_loss);
-                }
+                resid_cur -= delta * datX.col(j).head(num_loss);
             }
         }
-        
+    }
+    
+    void next_beta(Vector &res)
+    {
+        run_sweep(*this, AllCoords(), nvars);
+    }
+    
+    void next_beta_active(Vector &res)
+    {
+        run_sweep(*this, active, active.size());
     }
     
     
@@ -172,13 +155,13 @@ public:
              ConstGenericVector &datY_,
              ArrayXd &penalty_factor_,
              int &num_loss_,
-             double tol_ = 1e-6) :
-    CoordBase<Eigen::VectorXd>(datX_.rows(), datX_.cols(),
-              tol_),
+             double tol_ = 1e-6,
+             bool active_set_ = false) :
+    CoordSweep(datX_.rows(), datX_.cols(), penalty_factor_.size() > 0,
+               tol_, active_set_),
               datX(datX_.data(), datX_.rows(), datX_.cols()),
               datY(datY_.data(), datY_.size()),
               penalty_factor(penalty_factor_),
-              penalty_factor_size(penalty_factor_.size()),
               num_loss(num_loss_),
               resid_cur(datY_),  //assumes we start our beta estimate at 0 //
               XY(datX.topRows(num_loss_).transpose() * datY.head(num_loss_)),
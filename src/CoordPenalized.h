@@ -0,0 +1,568 @@
+#ifndef COORDPENALIZED_H
+#define COORDPENALIZED_H
+
+#include "CoordBase.h"
+#include "CVFold.h"
+#include "Linalg/BlasWrapper.h"
+#include "Linalg/Fused.h"
+#include "ADMMMatOp.h"
+#include "Penalty.h"
+#include "Spectra/SymEigsSolver.h"
+#include "utils.h"
+#include <limits>
+#include <random>
+#include <algorithm>
+#include <string>
+
+// order of the coordinates within a sweep
+enum CoordOrder
+{
+    ORDER_CYCLIC = 0,   // 0, 1, ..., p - 1
+    ORDER_RANDOM,       // a new random permutation for each sweep
+    ORDER_GREEDY,       // Gauss-Southwell, largest change first
+    ORDER_HOT           // by decreasing size of the last change
+};
+
+inline CoordOrder coord_order(const std::string &name)
+{
+    if (name == "random")
+        return ORDER_RANDOM;
+    if (name == "greedy")
+        return ORDER_GREEDY;
+    if (name == "hot")
+        return ORDER_HOT;
+    return ORDER_CYCLIC;
+}
+
+// coordinate descent engine for
+//   minimize  1/2 * ||y - X * beta||^2 + sum_j pf_j * P_lambda(beta_j)
+//
+// the penalty P is a policy from Penalty.h, so the thresholding
+// is inlined into the sweeps. whether penalty factors pf_j are used
+// is decided once per sweep, not once per coordinate.
+// CoordLasso and CoordMCP add the path initialization and the
+// convergence criteria on top of this class
+template<typename Penalty>
+class CoordPenalized: public CoordSweep //Eigen::SparseVector<double>
+{
+protected:
+    friend class CoordSweep;
+    
+    typedef float Scalar;
+    typedef double Double;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Map<const Matrix> MapMat;
+    typedef Eigen::Map<const Vector> MapVec;
+    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
+    typedef const Eigen::Ref<const Vector> ConstGenericVector;
+    typedef Eigen::SparseMatrix<double> SpMat;
+    typedef Eigen::SparseVector<double> SparseVector;
+    
+    MapMat datX;                  // data matrix
+    MapVec datY;                  // response vector
+    Vector XY;                    // X'Y
+    MatrixXd Xsq;                 // colSums(X^2)
+    
+    Scalar lambda;                // L1 penalty
+    Scalar lambda0;               // minimum lambda to make coefficients all zero
+    Penalty pen;                  // penalty policy and its parameters
+    
+    double threshval;
+    VectorXd resid_cur;
+    
+    ArrayXd penalty_factor;       // penalty multiplication factors
+    
+    bool covariance;              // covariance updates instead of residual updates
+    Vector grad_cur;              // X'r, only maintained in covariance mode
+    std::vector<Vector> XXcols;   // columns of X'X, computed when a variable first enters
+    SharedColumns *shared_gram;   // columns of X'X shared with other solvers, or NULL
+    double yy;                    // Y'Y, for the residual sum of squares in covariance mode
+    
+    double rss_cur;               // ||y - X * beta||^2, updated with each coordinate
+    double pen_cur;               // penalty of beta, updated with each coordinate
+    
+    int nthreads;                 // threads used for parallel (shotgun) sweeps
+    int block_size;               // number of coordinates updated concurrently
+    double obj_prev_sweep;        // objective after the previous parallel sweep
+    Vector block_delta;           // coefficient changes within a block
+    std::vector<int> block_idx;   // coordinates that changed within a block
+    
+    CoordOrder order;             // order of the coordinates within a sweep
+    std::mt19937 rng;             // for ORDER_RANDOM
+    std::vector<int> sweep_idx;   // coordinates in the order of the current sweep
+    Vector last_change;           // |change| of each coordinate at its last update, for ORDER_HOT
+    
+    // column j of X'X, computed lazily the first time
+    // variable j becomes nonzero (as in glmnet)
+    virtual const Vector &get_xx_col(int j)
+    {
+        if (shared_gram)
+            return shared_gram->col(j);
+        if (XXcols[j].size() == 0)
+            XXcols[j].noalias() = datX.transpose() * datX.col(j);
+        return XXcols[j];
+    }
+    
+    // ||y - X * beta||^2. In covariance mode the residual is not
+    // stored, but since X'r = X'y - X'X * beta we have
+    // ||r||^2 = y'y - beta'(X'y + X'r)
+    double rss()
+    {
+        if (covariance)
+            return yy - beta.dot(XY + grad_cur);
+        return resid_cur.squaredNorm();
+    }
+    
+    template<bool Weighted>
+    double compute_penalty()
+    {
+        double res = 0;
+        for (int j = 0; j < nvars; ++j)
+            res += pen.value(beta(j), Weighted ? penalty_factor(j) * lambda : lambda);
+        return res;
+    }
+    
+    // recompute the incrementally tracked terms from scratch, which
+    // also discards the rounding error accumulated along the path
+    void reset_objective()
+    {
+        rss_cur = rss();
+        pen_cur = weighted ? compute_penalty<true>() : compute_penalty<false>();
+    }
+    
+    // threshold coordinate j given xr = x_j'r. the residual sum of
+    // squares and the penalty are updated in O(1), the residual or
+    // gradient by the caller. returns the change in beta_j
+    template<bool Weighted>
+    double threshold_coord(int j, double xr)
+    {
+        const double lambda_j = Weighted ? penalty_factor(j) * lambda : lambda;
+        double beta_prev = beta(j);
+        double grad = xr / Xsq(j) + beta_prev;
+        
+        threshval = pen.threshold(grad, lambda_j / Xsq(j));
+        
+        double delta = threshval - beta_prev;
+        last_change(j) = std::abs(delta);
+        if (delta == 0)
+            return 0;
+        
+        beta(j) = threshval;
+        
+        // ||r - delta * x_j||^2 = ||r||^2 - delta * (2 * x_j'r - delta * ||x_j||^2)
+        rss_cur -= delta * (2 * xr - delta * Xsq(j));
+        pen_cur += pen.value(threshval, lambda_j) - pen.value(beta_prev, lambda_j);
+        max_change = std::max(max_change, std::abs(delta));
+        return delta;
+    }
+    
+    // covariance updates of coordinates idx[0], ..., idx[count - 1].
+    // the gradient X'r is updated (O(p)) for each coordinate that changes
+    template<bool Weighted, typename Index>
+    void sweep_covariance(const Index &idx, int count)
+    {
+        for (int k = 0; k < count; ++k)
+        {
+            const int j = idx[k];
+            double delta = threshold_coord<Weighted>(j, grad_cur(j));
+            if (delta != 0)
+                grad_cur -= delta * get_xx_col(j);
+        }
+    }
+    
+    // naive updates of coordinates idx[0], ..., idx[count - 1], keeping
+    // the residual up to date (O(n) per coordinate). the residual update
+    // for one coordinate is fused with the inner product for the next,
+    // so the residual is streamed once per coordinate
+    template<bool Weighted, typename Index>
+    void sweep_naive(const Index &idx, int count)
+    {
+        if (count < 1)
+            return;
+        
+        double *r = resid_cur.data();
+        double xr = Linalg::dot(datX.col(idx[0]).data(), r, nobs);
+        for (int k = 0; k < count; ++k)
+        {
+            const int j = idx[k];
+            double delta = threshold_coord<Weighted>(j, xr);
+            if (k + 1 < count)
+            {
+                const double *x_next = datX.col(idx[k + 1]).data();
+                if (delta != 0)
+                    xr = Linalg::axpy_dot(nobs, -delta, datX.col(j).data(), r, x_next);
+                else
+                    xr = Linalg::dot(x_next, r, nobs);
+            } else if (delta != 0)
+            {
+                resid_cur -= delta * datX.col(j);
+            }
+        }
+    }
+    
+    // orders coordinates by decreasing last change
+    struct HotFirst
+    {
+        const Vector &change;
+        HotFirst(const Vector &change_) : change(change_) {}
+        bool operator()(int i, int j) const { return change(i) > change(j); }
+    };
+    
+    // Gauss-Southwell selection: count times, update the coordinate
+    // among idx[0], ..., idx[count - 1] whose update would change it the
+    // most. needs the full gradient X'r, so uses covariance updates
+    template<bool Weighted, typename Index>
+    void sweep_greedy(const Index &idx, int count)
+    {
+        for (int t = 0; t < count; ++t)
+        {
+            int jmax = -1;
+            double change_max = 0;
+            for (int k = 0; k < count; ++k)
+            {
+                const int j = idx[k];
+                const double lambda_j = Weighted ? penalty_factor(j) * lambda : lambda;
+                double change = std::abs(pen.threshold(grad_cur(j) / Xsq(j) + beta(j), lambda_j / Xsq(j)) - beta(j));
+                if (change > change_max)
+                {
+                    change_max = change;
+                    jmax = j;
+                }
+            }
+            // all coordinates are at their minimum
+            if (jmax < 0)
+                break;
+            
+            double delta = threshold_coord<Weighted>(jmax, grad_cur(jmax));
+            grad_cur -= delta * get_xx_col(jmax);
+        }
+    }
+    
+    template<bool Weighted, typename Index>
+    void sweep_in_order(const Index &idx, int count)
+    {
+        if (covariance)
+            sweep_covariance<Weighted>(idx, count);
+        else
+            sweep_naive<Weighted>(idx, count);
+    }
+    
+    // sweep over idx[0], ..., idx[count - 1] in the chosen order
+    template<bool Weighted, typename Index>
+    void sweep(const Index &idx, int count)
+    {
+        switch (order)
+        {
+            case ORDER_GREEDY:
+                sweep_greedy<Weighted>(idx, count);
+                return;
+            case ORDER_RANDOM:
+                sweep_idx.resize(count);
+                for (int k = 0; k < count; ++k)
+                    sweep_idx[k] = idx[k];
+                std::shuffle(sweep_idx.begin(), sweep_idx.end(), rng);
+                break;
+            case ORDER_HOT:
+                sweep_idx.resize(count);
+                for (int k = 0; k < count; ++k)
+                    sweep_idx[k] = idx[k];
+                std::stable_sort(sweep_idx.begin(), sweep_idx.end(), HotFirst(last_change));
+                break;
+            default:
+                sweep_in_order<Weighted>(idx, count);
+                return;
+        }
+        sweep_in_order<Weighted>(sweep_idx, count);
+    }
+    
+    void next_beta(Vector &res)
+    {
+        if (block_size > 1)
+        {
+            if (weighted)
+                next_beta_parallel<true>();
+            else
+                next_beta_parallel<false>();
+        } else
+        {
+            run_sweep(*this, AllCoords(), nvars);
+        }
+    }
+    
+    void next_beta_active(Vector &res)
+    {
+        run_sweep(*this, active, active.size());
+    }
+    
+    // shotgun-style parallel sweep. the coordinates are split into
+    // strided blocks (columns far apart tend to be weakly correlated),
+    // all coordinates of a block are updated concurrently against the
+    // same residual and the residual is then updated once per block,
+    // with rows split across threads so no atomics are needed.
+    template<bool Weighted>
+    void next_beta_parallel()
+    {
+        const int nblocks = (nvars + block_size - 1) / block_size;
+        const int chunk = (nobs + nthreads - 1) / nthreads;
+        
+        for (int b = 0; b < nblocks; ++b)
+        {
+            const int bsize = (nvars - b + nblocks - 1) / nblocks;
+            
+            #pragma omp parallel for num_threads(nthreads) schedule(static)
+            for (int k = 0; k < bsize; ++k)
+            {
+                const int j = b + k * nblocks;
+                const double lambda_j = Weighted ? penalty_factor(j) * lambda : lambda;
+                double grad = Linalg::dot(datX.col(j).data(), resid_cur.data(), nobs) / Xsq(j) + beta(j);
+                double newval = pen.threshold(grad, lambda_j / Xsq(j));
+                block_delta(k) = newval - beta(j);
+                beta(j) = newval;
+            }
+            
+            int nchanged = 0;
+            for (int k = 0; k < bsize; ++k)
+            {
+                if (block_delta(k) != 0)
+                {
+                    block_idx[nchanged] = b + k * nblocks;
+                    max_change = std::max(max_change, std::abs(block_delta(k)));
+                    block_delta(nchanged) = block_delta(k);
+                    ++nchanged;
+                }
+            }
+            if (nchanged == 0)
+                continue;
+            
+            #pragma omp parallel for num_threads(nthreads) schedule(static)
+            for (int t = 0; t < nthreads; ++t)
+            {
+                const int start = t * chunk;
+                const int len = std::min(chunk, nobs - start);
+                if (len <= 0)
+                    continue;
+                for (int c = 0; c < nchanged; ++c)
+                    resid_cur.segment(start, len) -= block_delta(c) * datX.col(block_idx[c]).segment(start, len);
+            }
+        }
+        
+        // sequential coordinate descent never increases the objective,
+        // so an increase beyond rounding error means the block is too large
+        reset_objective();
+        double obj = 0.5 * rss_cur + pen_cur;
+        if (obj > obj_prev_sweep + std::abs(obj_prev_sweep) * tol)
+            set_block_size(block_size / 2);
+        obj_prev_sweep = obj;
+    }
+    
+    void set_block_size(int block_size_)
+    {
+        block_size = std::max(block_size_, 1);
+        block_delta.resize(block_size);
+        block_idx.resize(block_size);
+    }
+    
+    // Shotgun (Bradley et al., 2011) converges for up to p / rho
+    // concurrent updates, rho the spectral radius of X'X with
+    // unit-norm columns
+    void init_block_size()
+    {
+        Vector colsq = Xsq.transpose();
+        MatOpXXNormalized<Double> op(datX, colsq);
+        Spectra::SymEigsSolver< Double, Spectra::LARGEST_ALGE, MatOpXXNormalized<Double> > eigs(&op, 1, 3);
+        srand(0);
+        eigs.init();
+        eigs.compute(100, 0.1);
+        Vector evals = eigs.eigenvalues();
+        set_block_size(int(nvars / std::max(evals[0], 1.0)));
+    }
+    
+    // cold start at beta = 0
+    void reset_path(double lambda_)
+    {
+        beta.setZero();
+        resid_cur = datY; //reset residual vector
+        if (covariance)
+            grad_cur = XY;
+        
+        set_lambda(lambda_);
+    }
+    
+    void set_lambda(double lambda_)
+    {
+        lambda = lambda_;
+        obj_prev_sweep = std::numeric_limits<double>::infinity();
+        reset_objective();
+    }
+    
+    // replace the current beta by beta_ if beta_ has a smaller objective
+    void warm_start_from(const Vector &beta_)
+    {
+        Vector beta_cur = beta;
+        Vector resid_save = resid_cur, grad_save = grad_cur;
+        double rss_save = rss_cur, pen_save = pen_cur;
+        
+        beta = beta_;
+        if (covariance)
+            grad_cur = XY;
+        else
+            resid_cur = datY;
+        for (int j = 0; j < nvars; ++j)
+        {
+            if (beta(j) == 0)
+                continue;
+            if (covariance)
+                grad_cur -= beta(j) * get_xx_col(j);
+            else
+                resid_cur -= beta(j) * datX.col(j);
+        }
+        reset_objective();
+        
+        if (0.5 * rss_cur + pen_cur > 0.5 * rss_save + pen_save)
+        {
+            beta.swap(beta_cur);
+            resid_cur.swap(resid_save);
+            grad_cur.swap(grad_save);
+            rss_cur = rss_save;
+            pen_cur = pen_save;
+        }
+    }
+    
+    
+    // Calculate ||v1 - v2||^2 when v1 and v2 are sparse
+    static double diff_squared_norm(const SparseVector &v1, const SparseVector &v2)
+    {
+        const int n1 = v1.nonZeros(), n2 = v2.nonZeros();
+        const double *v1_val = v1.valuePtr(), *v2_val = v2.valuePtr();
+        const int *v1_ind = v1.innerIndexPtr(), *v2_ind = v2.innerIndexPtr();
+        
+        double r = 0.0;
+        int i1 = 0, i2 = 0;
+        while(i1 < n1 && i2 < n2)
+        {
+            if(v1_ind[i1] == v2_ind[i2])
+            {
+                double val = v1_val[i1] - v2_val[i2];
+                r += val * val;
+                i1++;
+                i2++;
+            } else if(v1_ind[i1] < v2_ind[i2]) {
+                r += v1_val[i1] * v1_val[i1];
+                i1++;
+            } else {
+                r += v2_val[i2] * v2_val[i2];
+                i2++;
+            }
+        }
+        while(i1 < n1)
+        {
+            r += v1_val[i1] * v1_val[i1];
+            i1++;
+        }
+        while(i2 < n2)
+        {
+            r += v2_val[i2] * v2_val[i2];
+            i2++;
+        }
+        
+        return r;
+    }
+    
+    // constructor from the sufficient statistics X'y, colSums(X^2) and
+    // y'y only, for solvers that never see the rows of X (e.g. the
+    // cross-validation folds). always uses covariance updates, so the
+    // derived class must provide the columns of X'X in get_xx_col()
+    CoordPenalized(int n_, int p_,
+                   const Vector &XY_,
+                   const Vector &Xsq_,
+                   double yy_,
+                   ArrayXd &penalty_factor_,
+                   double tol_ = 1e-6,
+                   bool active_set_ = false) :
+    CoordSweep(n_, p_, penalty_factor_.size() > 0,
+               tol_, active_set_),
+              datX(NULL, 0, p_),
+              datY(NULL, 0),
+              XY(XY_),
+              Xsq(Xsq_.transpose()),
+              lambda0(XY.cwiseAbs().maxCoeff()),
+              penalty_factor(penalty_factor_),
+              covariance(true),
+              grad_cur(XY_),
+              shared_gram(NULL),
+              yy(yy_),
+              nthreads(1),
+              block_size(1),
+              order(ORDER_CYCLIC),
+              last_change(Vector::Zero(p_))
+    {}
+
+
+public:
+    CoordPenalized(ConstGenericMatrix &datX_,
+                   ConstGenericVector &datY_,
+                   ArrayXd &penalty_factor_,
+                   double tol_ = 1e-6,
+                   bool covariance_ = false,
+                   bool active_set_ = false,
+                   int nthreads_ = 1) :
+    CoordSweep(datX_.rows(), datX_.cols(), penalty_factor_.size() > 0,
+               tol_, active_set_),
+              datX(datX_.data(), datX_.rows(), datX_.cols()),
+              datY(datY_.data(), datY_.size()),
+              XY(datX.transpose() * datY),
+              Xsq(datX.array().square().colwise().sum()),
+              lambda0(XY.cwiseAbs().maxCoeff()),
+              resid_cur(datY_),  //assumes we start our beta estimate at 0
+              penalty_factor(penalty_factor_),
+              covariance(covariance_),
+              shared_gram(NULL),
+              yy(datY.squaredNorm()),
+              nthreads(nthreads_),
+              block_size(1),
+              order(ORDER_CYCLIC),
+              last_change(Vector::Zero(datX_.cols()))
+    {
+        if (covariance)
+        {
+            grad_cur = XY;
+            XXcols.resize(nvars);
+        }
+        
+        // parallel sweeps only apply to the naive (residual) updates
+        if (nthreads > 1 && !covariance)
+            init_block_size();
+    }
+    
+    double get_lambda_zero() const { return lambda0; }
+    
+    // take the columns of X'X in covariance mode from gram, which must
+    // be those of datX, instead of caching them in this solver. set
+    // before copying the solver, so that the copies share the cache
+    void share_gram(SharedColumns *gram) { shared_gram = gram; }
+    
+    // choose the order of the coordinates within a sweep, before the
+    // path is started. greedy selection switches to covariance updates
+    // and sequential sweeps, random and hot-first orders only apply to
+    // the sequential sweeps (nthreads = 1)
+    void set_order(CoordOrder order_, unsigned int seed = 0)
+    {
+        order = order_;
+        rng.seed(seed);
+        if (order == ORDER_GREEDY)
+        {
+            if (!covariance)
+            {
+                covariance = true;
+                grad_cur = XY;
+                XXcols.resize(nvars);
+            }
+            set_block_size(1);
+        }
+    }
+};
+
+
+
+#endif // COORDPENALIZED_H
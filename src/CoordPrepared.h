@@ -0,0 +1,43 @@
+#ifndef COORDPREPARED_H
+#define COORDPREPARED_H
+
+#include "CoordMCP.h"
+#include "PreparedDesign.h"
+
+// concave penalized solver for a prepared design (PreparedDesign.h).
+// only X'y of the new response is computed, the columns of X'X are
+// those of the design, shared with all earlier and later fits
+template<typename Penalty>
+class CoordConcavePrepared: public CoordConcave<Penalty>
+{
+private:
+    typedef typename CoordConcave<Penalty>::Vector Vector;
+    
+    PreparedDesign &design;
+    
+    const Vector &get_xx_col(int j)
+    {
+        return design.gram.col(j);
+    }
+    
+    static double centred_ss(const Vector &datY)
+    {
+        return (datY.array() - datY.mean()).matrix().squaredNorm();
+    }
+
+public:
+    // datY is the response standardized by design.standardize_response()
+    CoordConcavePrepared(PreparedDesign &design_, const Vector &datY,
+                         ArrayXd &penalty_factor_,
+                         double tol_ = 1e-6, bool active_set_ = false) :
+    CoordConcave<Penalty>(design_.n, design_.p,
+                          design_.X.transpose() * datY, design_.Xsq,
+                          datY.squaredNorm(), centred_ss(datY),
+                          penalty_factor_, tol_, active_set_),
+    design(design_)
+    {}
+};
+
+
+
+#endif // COORDPREPARED_H
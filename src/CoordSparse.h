@@ -0,0 +1,201 @@
+#ifndef COORDSPARSE_H
+#define COORDSPARSE_H
+
+#include "CoordBase.h"
+#include "Penalty.h"
+
+// minimize  1/2 * ||y - Xs * beta||^2 + sum_j pf_j * P_lambda(beta_j)
+//
+// for a sparse X in compressed column storage, with the standardized
+// columns xs_j = (x_j - m_j) / s_j. The centred columns are dense, so
+// they are never formed. The residual is stored as r = r_s + c * 1, a
+// vector r_s and a scalar shift c: updating beta_j by delta changes
+// r_s by -delta / s_j * x_j on the nonzeros of x_j only and c by
+// delta * m_j / s_j, and
+//
+//   xs_j'r = (x_j'r_s + c * sum(x_j) - m_j * sum(r)) / s_j
+//
+// with sum(r) updated in O(1). A coordinate step costs O(nnz_j)
+// instead of O(n). The centres and scales come from DataStd::set_moments()
+template<typename Penalty>
+class CoordSparse: public CoordSweep
+{
+protected:
+    friend class CoordSweep;
+    
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Array<double, Eigen::Dynamic, 1> Array;
+    typedef const Eigen::Ref<const Vector> ConstGenericVector;
+    
+    // compressed column storage of X
+    const int *col_start;         // nonzeros of column j are col_start[j], ..., col_start[j + 1] - 1
+    const int *row_idx;
+    const double *values;
+    
+    Vector datY;                  // standardized response
+    Array center;                 // m_j
+    Array scale;                  // s_j
+    Array colsum;                 // sum(x_j)
+    Vector Xsq;                   // ||xs_j||^2
+    
+    double lambda;                // penalty parameter
+    double lambda0;               // minimum lambda to make coefficients all zero
+    Penalty pen;                  // penalty policy and its parameters
+    
+    ArrayXd penalty_factor;       // penalty multiplication factors
+    
+    Vector resid_cur;             // r_s
+    double resid_shift;           // c
+    double resid_sum;             // sum(r)
+    
+    double rss_cur;               // ||r||^2, updated with each coordinate
+    double pen_cur;               // penalty of beta, updated with each coordinate
+    double null_dev;              // ||y||^2 of the standardized response
+    double objective;
+    double objective_prev;
+    
+    double col_dot(int j, const double *v) const
+    {
+        double res = 0;
+        for (int k = col_start[j]; k < col_start[j + 1]; ++k)
+            res += values[k] * v[row_idx[k]];
+        return res;
+    }
+    
+    // xs_j'r
+    double grad(int j) const
+    {
+        return (col_dot(j, resid_cur.data()) + resid_shift * colsum[j] - center[j] * resid_sum) / scale[j];
+    }
+    
+    // r <- r - delta * xs_j
+    void update_resid(int j, double delta)
+    {
+        const double a = delta / scale[j];
+        double *r = resid_cur.data();
+        for (int k = col_start[j]; k < col_start[j + 1]; ++k)
+            r[row_idx[k]] -= a * values[k];
+        resid_shift += a * center[j];
+        resid_sum -= a * (colsum[j] - nobs * center[j]);
+    }
+    
+    template<bool Weighted, typename Index>
+    void sweep(const Index &idx, int count)
+    {
+        for (int k = 0; k < count; ++k)
+        {
+            const int j = idx[k];
+            const double lambda_j = Weighted ? penalty_factor(j) * lambda : lambda;
+            const double xr = grad(j);
+            const double beta_prev = beta(j);
+            
+            double newval = pen.threshold(xr / Xsq(j) + beta_prev, lambda_j / Xsq(j));
+            double delta = newval - beta_prev;
+            if (delta == 0)
+                continue;
+            
+            beta(j) = newval;
+            update_resid(j, delta);
+            rss_cur -= delta * (2 * xr - delta * Xsq(j));
+            pen_cur += pen.value(newval, lambda_j) - pen.value(beta_prev, lambda_j);
+            max_change = std::max(max_change, std::abs(delta));
+        }
+    }
+    
+    void next_beta(Vector &res)
+    {
+        run_sweep(*this, AllCoords(), nvars);
+    }
+    
+    void next_beta_active(Vector &res)
+    {
+        run_sweep(*this, active, active.size());
+    }
+    
+    // glmnet stopping criterion, as in CoordConcave
+    bool converged()
+    {
+        objective_prev = objective;
+        objective = 0.5 * rss_cur + pen_cur;
+        if (max_change == 0)
+            return true;
+        return (std::abs(objective_prev - objective) < null_dev * tol);
+    }
+    
+    // recompute the incrementally tracked terms from scratch
+    void reset_objective()
+    {
+        rss_cur = resid_cur.squaredNorm() + resid_shift * (2 * resid_cur.sum() + nobs * resid_shift);
+        pen_cur = 0;
+        for (int j = 0; j < nvars; ++j)
+            pen_cur += pen.value(beta(j), weighted ? penalty_factor(j) * lambda : lambda);
+        objective = 0.5 * rss_cur + pen_cur;
+    }
+
+public:
+    // X is a compressed sparse matrix (e.g. Eigen::MappedSparseMatrix),
+    // datY_ the response, already centred and scaled, and center_ and
+    // scale_ the m_j and s_j above
+    template<typename SparseMatrix>
+    CoordSparse(const SparseMatrix &X,
+                ConstGenericVector &datY_,
+                const Array &center_,
+                const Array &scale_,
+                ArrayXd &penalty_factor_,
+                double tol_ = 1e-6,
+                bool active_set_ = false) :
+    CoordSweep(X.rows(), X.cols(), penalty_factor_.size() > 0,
+               tol_, active_set_),
+              col_start(X.outerIndexPtr()),
+              row_idx(X.innerIndexPtr()),
+              values(X.valuePtr()),
+              datY(datY_),
+              center(center_),
+              scale(scale_),
+              colsum(X.cols()),
+              Xsq(X.cols()),
+              penalty_factor(penalty_factor_)
+    {
+        const double ysum = datY.sum();
+        Vector XY(nvars);
+        for (int j = 0; j < nvars; ++j)
+        {
+            double s = 0, ss = 0;
+            for (int k = col_start[j]; k < col_start[j + 1]; ++k)
+            {
+                s += values[k];
+                ss += values[k] * values[k];
+            }
+            colsum[j] = s;
+            Xsq(j) = (ss - 2 * center[j] * s + nobs * center[j] * center[j]) / (scale[j] * scale[j]);
+            XY(j) = (col_dot(j, datY.data()) - center[j] * ysum) / scale[j];
+        }
+        lambda0 = XY.cwiseAbs().maxCoeff();
+        null_dev = datY.squaredNorm();
+    }
+    
+    double get_lambda_zero() const { return lambda0; }
+    
+    void set_penalty(const Penalty &pen_) { pen = pen_; }
+    
+    // init() is a cold start for the first lambda
+    void init(double lambda_)
+    {
+        beta.setZero();
+        resid_cur = datY;
+        resid_shift = 0;
+        resid_sum = datY.sum();
+        lambda = lambda_;
+        reset_objective();
+    }
+    // warm start from the solution for the previous lambda
+    void init_warm(double lambda_)
+    {
+        lambda = lambda_;
+        reset_objective();
+    }
+};
+
+
+
+#endif // COORDSPARSE_H
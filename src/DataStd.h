@@ -1,8 +1,8 @@
 #ifndef DATASTD_H
 #define DATASTD_H
 
-#include <RcppEigen.h>
-#include <Eigen/Core>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 #ifdef __AVX__
 #include "Linalg/AVX.h"
@@ -90,10 +90,17 @@ public:
     }
 
     void standardize(MatrixXd &X, Vector &Y)
+    {
+        standardize_y(Y);
+        standardize_x(X);
+    }
+
+    // standardize Y only, e.g. a new response for a design
+    // that was standardized once with standardize_x()
+    void standardize_y(Vector &Y)
     {
         double n_invsqrt = 1.0 / std::sqrt(Double(n));
 
-        // standardize Y
         switch(flag)
         {
             case 1:
@@ -110,8 +117,14 @@ public:
             default:
                 break;
         }
+    }
+
+    // standardize X only, for responses that are not centred or scaled
+    // (e.g. binomial or Poisson), in which case meanY = 0 and scaleY = 1
+    void standardize_x(MatrixXd &X)
+    {
+        double n_invsqrt = 1.0 / std::sqrt(Double(n));
 
-        // standardize X
         switch(flag)
         {
             case 1:
@@ -209,7 +222,52 @@ public:
         }
     }
 
+    // the same standardization as standardize(), but computed from the
+    // column sums sx and sxx = colSums(X^2) of X and the sums sy and syy
+    // of Y and Y^2 only, e.g. for the training rows of a cross-validation
+    // fold. the data are not modified
+    void set_moments(const Array &sx, const Array &sxx, double sy, double syy)
+    {
+        const double m = Double(n);
+        const double my = sy / m;
+        const Array mx = sx / m;
+
+        set_centred_moments(mx, sxx / m - mx.square(), my, syy / m - my * my);
+    }
+
+    // the same from the means and (biased) variances of the columns of X
+    // and of Y, e.g. accumulated about a shift to avoid cancellation
+    void set_centred_moments(const Array &mx, const Array &varx, double my, double vary)
+    {
+        const double sdy = std::sqrt(vary);
+
+        switch(flag)
+        {
+            case 1:
+                scaleY = sdy;
+                scaleX = varx.sqrt();
+                break;
+            case 2:
+                meanY = my;
+                scaleY = sdy;
+                meanX = mx;
+                break;
+            case 3:
+                meanY = my;
+                scaleY = sdy;
+                meanX = mx;
+                scaleX = varx.sqrt();
+                break;
+            default:
+                break;
+        }
+    }
+
     double get_scaleY() { return scaleY; }
+    double get_meanY() const { return meanY; }
+    // centre and scale of column j, 0 and 1 if not centred or scaled
+    double get_meanX(int j) const { return (flag & 2) ? meanX[j] : 0.0; }
+    double get_scaleX(int j) const { return (flag & 1) ? scaleX[j] : 1.0; }
 };
 
 
@@ -0,0 +1,83 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <chrono>
+
+// the check for a request to interrupt the solvers, e.g. Ctrl-C in R.
+// returns true if one is pending. nothing is checked until it is set:
+// the R entry points set it to the R check (RcppBinding.h)
+typedef bool (*InterruptCheck)();
+
+inline InterruptCheck &interrupt_check()
+{
+    static InterruptCheck check = NULL;
+    return check;
+}
+
+inline void set_interrupt_check(InterruptCheck check) { interrupt_check() = check; }
+
+
+// a time budget and cooperative interruption for a path of fits. the
+// solvers hold a pointer to it, NULL when there is neither, and call
+// expired() after each iteration, from the thread that runs the path.
+// once the budget is used up or an interrupt is pending, expired()
+// stays true, solve() returns after the iteration it has finished and
+// the caller stops the path there. the budget counts from construction,
+// less the seconds already spent by the caller, and the interrupt check,
+// which is slower than reading the clock, runs at most every
+// poll_interval seconds
+class SolveDeadline
+{
+public:
+    enum Reason { NONE = 0, TIME_LIMIT, INTERRUPTED };
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const Clock::time_point start;
+    const double budget;          // seconds, <= 0 for none
+    const bool interruptible;
+    const double poll_interval;
+    double next_poll;             // seconds since start
+    Reason reason;
+
+    double elapsed() const
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+public:
+    SolveDeadline(double budget_, bool interruptible_, double spent = 0.0,
+                  double poll_interval_ = 0.1) :
+        start(Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spent))),
+        budget(budget_), interruptible(interruptible_),
+        poll_interval(poll_interval_), next_poll(0.0), reason(NONE)
+    {}
+
+    bool expired()
+    {
+        if (reason != NONE)
+            return true;
+        if (budget <= 0 && !interruptible)
+            return false;
+
+        const double now = elapsed();
+        if (budget > 0 && now >= budget)
+        {
+            reason = TIME_LIMIT;
+        } else if (interruptible && now >= next_poll && interrupt_check()) {
+            next_poll = now + poll_interval;
+            if (interrupt_check()())
+                reason = INTERRUPTED;
+        }
+        return reason != NONE;
+    }
+
+    bool stopped() const { return reason != NONE; }
+    Reason get_reason() const { return reason; }
+    double get_elapsed() const { return elapsed(); }
+};
+
+
+
+#endif // DEADLINE_H
@@ -1,8 +1,12 @@
 #ifndef FADMMBASE_H
 #define FADMMBASE_H
 
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "Console.h"
 #include "Linalg/BlasWrapper.h"
+#include "Telemetry.h"
+#include "Deadline.h"
 
 // General problem setting
 //   minimize f(x) + g(z)
@@ -41,6 +45,9 @@ protected:
     double resid_primal;  // primal residual
     double resid_dual;    // dual residual
 
+    SolverTelemetry *telemetry;  // timings of the phases, NULL if not recorded
+    SolveDeadline *deadline;     // time budget and interruption, NULL if none
+
     virtual void A_mult (VecTypeNu &res, VecTypeBeta &x) = 0;   // operation res -> Ax, x can be overwritten
     virtual void At_mult(VecTypeNu &res, VecTypeNu &y) = 0;   // operation res -> A'y, y can be overwritten
     virtual void B_mult (VecTypeNu &res, VecTypeGamma &z) = 0;   // operation res -> Bz, z can be overwritten
@@ -101,31 +108,45 @@ protected:
 
         return rho * resid_primal * resid_primal + rho * tmp2.squaredNorm();
     }
+    // rho_changed_action() for a new rho, timed and
+    // counted as a factorization
+    void refactor()
+    {
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::FACTORIZE);
+        rho_changed_action();
+        if(telemetry)
+            telemetry->refactored();
+    }
     // increase or decrease rho in iterations
     virtual void update_rho()
     {
+        const double old_rho = rho;
+
         if(resid_primal / eps_primal > 10 * resid_dual / eps_dual)
         {
             rho *= 2;
-            rho_changed_action();
+            refactor();
         }
         else if(resid_dual / eps_dual > 10 * resid_primal / eps_primal)
         {
             rho /= 2;
-            rho_changed_action();
+            refactor();
         }
 
         if(resid_primal < eps_primal)
         {
             rho /= 1.2;
-            rho_changed_action();
+            refactor();
         }
 
         if(resid_dual < eps_dual)
         {
             rho *= 1.2;
-            rho_changed_action();
+            refactor();
         }
+
+        if(telemetry && rho != old_rho)
+            telemetry->rho_changed();
     }
     // Debugging residual information
     void print_header(std::string title)
@@ -133,36 +154,36 @@ protected:
         const int width = 80;
         const char sep = ' ';
 
-        Rcpp::Rcout << std::endl << std::string(width, '=') << std::endl;
-        Rcpp::Rcout << std::string((width - title.length()) / 2, ' ') << title << std::endl;
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::endl << std::string(width, '=') << std::endl;
+        console() << std::string((width - title.length()) / 2, ' ') << title << std::endl;
+        console() << std::string(width, '-') << std::endl;
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << "iter";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "rho";
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << "iter";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "rho";
+        console() << std::endl;
 
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::string(width, '-') << std::endl;
     }
     void print_row(int iter)
     {
         const char sep = ' ';
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << iter;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << rho;
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << iter;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << rho;
+        console() << std::endl;
     }
     void print_footer()
     {
         const int width = 80;
-        Rcpp::Rcout << std::string(width, '=') << std::endl << std::endl;
+        console() << std::string(width, '=') << std::endl << std::endl;
     }
 
 public:
@@ -173,15 +194,21 @@ public:
         adj_gamma(m_), adj_nu(p_),
         old_gamma(m_), old_nu(p_),
         adj_a(1.0), adj_c(9999),
-        eps_abs(eps_abs_), eps_rel(eps_rel_)
+        eps_abs(eps_abs_), eps_rel(eps_rel_),
+        telemetry(NULL), deadline(NULL)
     {}
 
     virtual ~FADMMBase() {}
 
     void update_beta()
     {
-        eps_primal = compute_eps_primal();
-        eps_dual = compute_eps_dual();
+        {
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
+            eps_primal = compute_eps_primal();
+            eps_dual = compute_eps_dual();
+        }
+
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::X_UPDATE);
 
         VecTypeBeta newbeta(dim_main);
         next_beta(newbeta);
@@ -190,14 +217,19 @@ public:
     }
     void update_gamma()
     {
-        VecTypeGamma newgamma(dim_aux);
-        next_gamma(newgamma);
-        aux_gamma.swap(newgamma);
+        {
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Z_UPDATE);
+            VecTypeGamma newgamma(dim_aux);
+            next_gamma(newgamma);
+            aux_gamma.swap(newgamma);
+        }
 
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
         resid_dual = compute_resid_dual();
     }
     void update_nu()
     {
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Y_UPDATE);
         VecTypeNu newr(dim_dual);
         next_residual(newr);
 
@@ -229,26 +261,35 @@ public:
             update_nu();
 
             // print_row(i);
+            if(telemetry)
+                telemetry->sample(i, resid_primal, resid_dual, rho);
 
             if(converged())
                 break;
 
-            double old_c = adj_c;
-            adj_c = compute_resid_combined();
+            if(deadline && deadline->expired())
+                break;
 
-            if(adj_c < 0.999 * old_c)
             {
-                double old_a = adj_a;
-                adj_a = 0.5 + 0.5 * std::sqrt(1 + 4.0 * old_a * old_a);
-                double ratio = (old_a - 1.0) / adj_a;
-                adj_gamma = (1 + ratio) * aux_gamma - ratio * old_gamma;
-                adj_nu.noalias() = (1 + ratio) * dual_nu - ratio * old_nu;
-            } else {
-                adj_a = 1.0;
-                adj_gamma = old_gamma;
-                // adj_nu = old_nu;
-                std::copy(old_nu.data(), old_nu.data() + dim_dual, adj_nu.data());
-                adj_c = old_c / 0.999;
+                // the restart or momentum step is part of the dual update
+                SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Y_UPDATE);
+                double old_c = adj_c;
+                adj_c = compute_resid_combined();
+
+                if(adj_c < 0.999 * old_c)
+                {
+                    double old_a = adj_a;
+                    adj_a = 0.5 + 0.5 * std::sqrt(1 + 4.0 * old_a * old_a);
+                    double ratio = (old_a - 1.0) / adj_a;
+                    adj_gamma = (1 + ratio) * aux_gamma - ratio * old_gamma;
+                    adj_nu.noalias() = (1 + ratio) * dual_nu - ratio * old_nu;
+                } else {
+                    adj_a = 1.0;
+                    adj_gamma = old_gamma;
+                    // adj_nu = old_nu;
+                    std::copy(old_nu.data(), old_nu.data() + dim_dual, adj_nu.data());
+                    adj_c = old_c / 0.999;
+                }
             }
             // only update rho after a few iterations and after every 40 iterations.
             // too many updates makes it slow.
@@ -257,10 +298,21 @@ public:
         }
 
         // print_footer();
+        if(telemetry && maxit > 0)
+            telemetry->finish(std::min(i, maxit - 1), resid_primal, resid_dual, rho);
 
         return i + 1;
     }
 
+    // records the phases of the following fits in telemetry_
+    void set_telemetry(SolverTelemetry *telemetry_) { telemetry = telemetry_; }
+
+    // stops the following fits after the iteration in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+
+    double get_resid_primal() const { return resid_primal; }
+    double get_resid_dual() const { return resid_dual; }
+
     virtual VecTypeBeta get_beta() { return main_beta; }
     virtual VecTypeGamma get_gamma() { return aux_gamma; }
     virtual VecTypeNu get_nu() { return dual_nu; }
@@ -1,8 +1,11 @@
 #ifndef FADMMBASEPRECOND_H
 #define FADMMBASEPRECOND_H
 
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "Console.h"
 #include "Linalg/BlasWrapper.h"
+#include "Deadline.h"
 
 // General problem setting
 //   minimize f(x) + g(z)
@@ -42,6 +45,8 @@ protected:
     double resid_primal;    // primal residual
     double resid_dual;      // dual residual
 
+    SolveDeadline *deadline; // time budget and interruption, NULL if none
+
     virtual void A_mult (VecTypeNu &res, VecTypeBeta &x) = 0;   // operation res -> Ax, x can be overwritten
     virtual void At_mult(VecTypeNu &res, VecTypeNu &y) = 0;     // operation res -> A'y, y can be overwritten
     virtual void B_mult (VecTypeNu &res, VecTypeGamma &z) = 0;  // operation res -> Bz, z can be overwritten
@@ -138,36 +143,36 @@ protected:
         const int width = 80;
         const char sep = ' ';
 
-        Rcpp::Rcout << std::endl << std::string(width, '=') << std::endl;
-        Rcpp::Rcout << std::string((width - title.length()) / 2, ' ') << title << std::endl;
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::endl << std::string(width, '=') << std::endl;
+        console() << std::string((width - title.length()) / 2, ' ') << title << std::endl;
+        console() << std::string(width, '-') << std::endl;
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << "iter";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << "rho";
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << "iter";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_primal";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "eps_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "resid_dual";
+        console() << std::left << std::setw(13) << std::setfill(sep) << "rho";
+        console() << std::endl;
 
-        Rcpp::Rcout << std::string(width, '-') << std::endl;
+        console() << std::string(width, '-') << std::endl;
     }
     void print_row(int iter)
     {
         const char sep = ' ';
 
-        Rcpp::Rcout << std::left << std::setw(7)  << std::setfill(sep) << iter;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
-        Rcpp::Rcout << std::left << std::setw(13) << std::setfill(sep) << rho;
-        Rcpp::Rcout << std::endl;
+        console() << std::left << std::setw(7)  << std::setfill(sep) << iter;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_primal;
+        console() << std::left << std::setw(13) << std::setfill(sep) << eps_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << resid_dual;
+        console() << std::left << std::setw(13) << std::setfill(sep) << rho;
+        console() << std::endl;
     }
     void print_footer()
     {
         const int width = 80;
-        Rcpp::Rcout << std::string(width, '=') << std::endl << std::endl;
+        console() << std::string(width, '=') << std::endl << std::endl;
     }
 
 public:
@@ -179,7 +184,8 @@ public:
         adj_gamma(m_), adj_nu(p_),
         old_gamma(m_), old_nu(p_),
         adj_c(1e20),
-        eps_abs(eps_abs_), eps_rel(eps_rel_)
+        eps_abs(eps_abs_), eps_rel(eps_rel_),
+        deadline(NULL)
     {}
 
     virtual ~FADMMBasePrecond() {}
@@ -239,6 +245,9 @@ public:
             if(converged())
                 break;
 
+            if(deadline && deadline->expired())
+                break;
+
             //double old_c = adj_c;
             //adj_c = compute_resid_combined();
             
@@ -256,6 +265,12 @@ public:
         return i + 1;
     }
 
+    // stops the following fits after the iteration in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+
+    double get_resid_primal() const { return resid_primal; }
+    double get_resid_dual() const { return resid_dual; }
+
     virtual VecTypeBeta get_beta() { return main_beta; }
     virtual VecTypeGamma get_gamma() { return aux_gamma; }
     virtual VecTypeNu get_nu() { return dual_nu; }
@@ -1,9 +1,21 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "ADMMLassoTall.h"
 #include "ADMMLassoLogisticTall.h"
 #include "ADMMLassoWide.h"
+#include "ADMMLassoTallCV.h"
+#include "ADMMLassoTallPrepared.h"
+#include "ADMMLassoTallStream.h"
+#include "ADMMLassoTallPacked.h"
+#include "ADMMLassoTallOnline.h"
+#include "PADMMLasso.h"
+#include "PADMMLassoWide.h"
 #include "DataStd.h"
+#include "Telemetry.h"
+#include "Deadline.h"
+#include <limits>
 
 using Eigen::MatrixXf;
 using Eigen::VectorXf;
@@ -41,6 +53,285 @@ inline void write_beta_matrix(SpMat &betas, int col, double beta0, SpVec &coef,
     }
 }
 
+// the coefficients of a fit as written by write_beta_matrix()
+inline VectorXd beta_vector(int p, double beta0, const SpVec &coef, bool startatzero)
+{
+    VectorXd res = VectorXd::Zero(p + 1);
+    int add = 0;
+    if (!startatzero)
+    {
+        add = 1;
+        res[0] = beta0;
+    }
+    for(SpVec::InnerIterator iter(coef); iter; ++iter)
+        res[iter.index() + add] = iter.value();
+    return res;
+}
+
+// gaussian admm_lasso by consensus ADMM over nthreads blocks of rows
+// (PADMMLasso.h), with the workers in Scalar precision, on threads or
+// in worker processes. datX and datY are standardized as for the serial
+// solvers, and datX is released once the workers hold their copies of it
+template<typename Scalar>
+List admm_lasso_rows(MatrixXd &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                     ArrayXd &lambda, DataStd<double> &datstd,
+                     SEXP nlambda_, SEXP lmin_ratio_, int nthreads, bool processes,
+                     int maxit, double eps_abs, double eps_rel, double rho,
+                     bool record, const WallClock &clock, const PerfCounters *counters,
+                     SolveDeadline *deadline)
+{
+    const int n = datX.rows();
+    const int p = datX.cols();
+    int nlambda = lambda.size();
+    
+    // tolerances below the precision of Scalar are never met
+    const double eps_min = 10 * std::numeric_limits<Scalar>::epsilon();
+    PADMMLasso_Master<Scalar> solver(datX, datY, penalty_factor, nthreads, processes,
+                                     std::max(eps_abs, eps_min), std::max(eps_rel, eps_min));
+    
+    if (nlambda < 1) {
+        
+        double lmax = solver.get_lambda_zero() / n * datstd.get_scaleY();
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    SpMat beta(p + 1, nlambda);
+    beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
+    
+    SolverTelemetry telemetry(record ? nlambda : 0, counters);
+    SolverTelemetry *recorded = record ? &telemetry : NULL;
+    solver.set_telemetry(recorded);
+    solver.set_deadline(deadline);
+    if (recorded)
+        recorded->add_setup(clock.seconds());
+    
+    for(int i = 0; i < nlambda; i++)
+    {
+        double ilambda = lambda[i] * n / datstd.get_scaleY();
+        if (recorded)
+            recorded->begin(i);
+        {
+            SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+            if(i == 0)
+                solver.init(ilambda, rho);
+            else
+                solver.init_warm(ilambda);
+        }
+        
+        niter[i] = solver.solve(maxit);
+        SpVec res = solver.get_z();
+        double beta0 = 0.0;
+        datstd.recover(beta0, res);
+        if (deadline && deadline->stopped())
+        {
+            partial = partial_fit(*deadline, lambda[i], niter[i], solver.get_resid_primal(),
+                                  solver.get_resid_dual(), beta_vector(p, beta0, res, false));
+            nfit = i;
+            break;
+        }
+        write_beta_matrix(beta, i, beta0, res, false);
+    }
+    
+    beta.makeCompressed();
+    
+    return path_result(lambda, beta, niter, recorded, nfit, partial);
+}
+
+// gaussian admm_lasso by sharing ADMM over nthreads blocks of columns
+// (PADMMLassoWide.h), for wide X. datX is released once the workers
+// hold their copies of it
+List admm_lasso_columns(MatrixXd &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                        ArrayXd &lambda, DataStd<double> &datstd,
+                        SEXP nlambda_, SEXP lmin_ratio_, int nthreads,
+                        int maxit, double eps_abs, double eps_rel, double rho,
+                        bool record, const WallClock &clock, const PerfCounters *counters,
+                        SolveDeadline *deadline)
+{
+    const int n = datX.rows();
+    const int p = datX.cols();
+    int nlambda = lambda.size();
+    
+    PADMMLassoWide_Master solver(datX, datY, penalty_factor, nthreads, eps_abs, eps_rel);
+    datX.resize(0, 0);
+    
+    if (nlambda < 1) {
+        
+        double lmax = solver.get_lambda_zero() / n * datstd.get_scaleY();
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    SpMat beta(p + 1, nlambda);
+    beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
+    
+    SolverTelemetry telemetry(record ? nlambda : 0, counters);
+    SolverTelemetry *recorded = record ? &telemetry : NULL;
+    solver.set_telemetry(recorded);
+    solver.set_deadline(deadline);
+    if (recorded)
+        recorded->add_setup(clock.seconds());
+    
+    for(int i = 0; i < nlambda; i++)
+    {
+        double ilambda = lambda[i] * n / datstd.get_scaleY();
+        if (recorded)
+            recorded->begin(i);
+        {
+            SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+            if(i == 0)
+                solver.init(ilambda, rho);
+            else
+                solver.init_warm(ilambda, i);
+        }
+        
+        niter[i] = solver.solve(maxit);
+        SpVec res = solver.get_beta();
+        double beta0 = 0.0;
+        datstd.recover(beta0, res);
+        if (deadline && deadline->stopped())
+        {
+            partial = partial_fit(*deadline, lambda[i], niter[i], solver.get_resid_primal(),
+                                  solver.get_resid_dual(), beta_vector(p, beta0, res, false));
+            nfit = i;
+            break;
+        }
+        write_beta_matrix(beta, i, beta0, res, false);
+    }
+    
+    beta.makeCompressed();
+    
+    return path_result(lambda, beta, niter, recorded, nfit, partial);
+}
+
+// gaussian admm_lasso path of a tall solver for p variables that holds
+// the standardized X'X and X'y of n rows, e.g. accumulated by StreamGram
+// (ADMMLassoTallStream) or in packed storage (ADMMLassoTallPacked)
+template<typename Solver>
+List admm_lasso_gram_path(Solver &solver, DataStd<double> &datstd,
+                          int n, int p, ArrayXd &lambda,
+                          SEXP nlambda_, SEXP lmin_ratio_,
+                          int maxit, double rho,
+                          bool record, const WallClock &clock, const PerfCounters *counters,
+                          SolveDeadline *deadline)
+{
+    int nlambda = lambda.size();
+    
+    if (nlambda < 1) {
+        
+        double lmax = solver.get_lambda_zero() / n * datstd.get_scaleY();
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    SpMat beta(p + 1, nlambda);
+    beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
+    
+    SolverTelemetry telemetry(record ? nlambda : 0, counters);
+    SolverTelemetry *recorded = record ? &telemetry : NULL;
+    solver.set_telemetry(recorded);
+    solver.set_deadline(deadline);
+    if (recorded)
+        recorded->add_setup(clock.seconds());
+    
+    for(int i = 0; i < nlambda; i++)
+    {
+        double ilambda = lambda[i] * n / datstd.get_scaleY();
+        if (recorded)
+            recorded->begin(i);
+        {
+            SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+            if(i == 0)
+                solver.init(ilambda, rho);
+            else
+                solver.init_warm(ilambda);
+        }
+        
+        niter[i] = solver.solve(maxit);
+        SpVec res = solver.get_gamma();
+        double beta0 = 0.0;
+        datstd.recover(beta0, res);
+        if (deadline && deadline->stopped())
+        {
+            partial = partial_fit(*deadline, lambda[i], niter[i], solver.get_resid_primal(),
+                                  solver.get_resid_dual(), beta_vector(p, beta0, res, false));
+            nfit = i;
+            break;
+        }
+        write_beta_matrix(beta, i, beta0, res, false);
+    }
+    
+    beta.makeCompressed();
+    
+    return path_result(lambda, beta, niter, recorded, nfit, partial);
+}
+
+// gaussian admm_lasso for tall X (n > 2p) by ADMMLassoTall, which only
+// needs the standardized X'X and X'y. they are accumulated with the
+// means and scales in one parallel pass over the unstandardized data
+// (StreamGram::add_matrix()), instead of a pass to standardize X and
+// another for X'X
+List admm_lasso_tall(const MatrixXd &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                     ArrayXd &lambda, bool standardize, bool intercept,
+                     SEXP nlambda_, SEXP lmin_ratio_, int nthreads,
+                     int maxit, double eps_abs, double eps_rel, double rho,
+                     bool record, const WallClock &clock, const PerfCounters *counters,
+                     SolveDeadline *deadline)
+{
+    StreamGram stats(datX.cols(), standardize, intercept);
+    stats.add_matrix(datX, datY.data(), nthreads);
+    
+    MatrixXd XX;
+    VectorXd XY;
+    DataStd<double> datstd = stats.standardized(XX, XY);
+    
+    ADMMLassoTallStream solver(XX, XY, penalty_factor, eps_abs, eps_rel);
+    return admm_lasso_gram_path(solver, datstd, datX.rows(), datX.cols(), lambda,
+                                nlambda_, lmin_ratio_, maxit, rho,
+                                record, clock, counters, deadline);
+}
+
+// gaussian admm_lasso for tall X with X'X in packed storage
+// (ADMMLassoTallPacked), which with its factorization takes about
+// half the memory of the dense X'X alone. X and y are standardized in
+// place and X'X is built in parallel blocks
+List admm_lasso_packed(MatrixXd &datX, VectorXd &datY, ArrayXd &penalty_factor,
+                       ArrayXd &lambda, bool standardize, bool intercept,
+                       SEXP nlambda_, SEXP lmin_ratio_, int nthreads,
+                       int maxit, double eps_abs, double eps_rel, double rho,
+                       bool record, const WallClock &clock, const PerfCounters *counters,
+                       SolveDeadline *deadline)
+{
+    const int n = datX.rows();
+    const int p = datX.cols();
+    
+    DataStd<double> datstd(n, p, standardize, intercept);
+    datstd.standardize(datX, datY);
+    
+    ADMMLassoTallPacked solver(datX, datY, penalty_factor, nthreads, eps_abs, eps_rel);
+    return admm_lasso_gram_path(solver, datstd, n, p, lambda,
+                                nlambda_, lmin_ratio_, maxit, rho,
+                                record, clock, counters, deadline);
+}
+
 RcppExport SEXP admm_lasso(SEXP x_, 
                            SEXP y_, 
                            SEXP family_,
@@ -54,6 +345,9 @@ RcppExport SEXP admm_lasso(SEXP x_,
 {
 BEGIN_RCPP
 
+    // the setup of the telemetry counts from here
+    const WallClock clock;
+
     //Rcpp::NumericMatrix xx(x_);
     //Rcpp::NumericVector yy(y_);
     
@@ -99,10 +393,24 @@ BEGIN_RCPP
     const double eps_abs   = as<double>(opts["eps_abs"]);
     const double eps_rel   = as<double>(opts["eps_rel"]);
     const double rho       = as<double>(opts["rho"]);
+    const std::string parallel  = as<std::string>(opts["parallel"]);
+    const std::string precision = as<std::string>(opts["precision"]);
+    const std::string gram      = as<std::string>(opts["gram"]);
+    const bool processes   = as<std::string>(opts["transport"]) == "processes";
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const bool profile     = as<bool>(opts["counters"]);
+    const bool record      = profile || as<bool>(opts["telemetry"]);
+    SolveDeadline deadline(as<double>(opts["time_limit"]), as<bool>(opts["interruptible"]),
+                           clock.seconds());
     bool standardize   = as<bool>(standardize_);
     bool intercept     = as<bool>(intercept_);
     bool intercept_bin = intercept;
     
+    // opened before the solver starts its threads or processes, which
+    // are counted with this one
+    PerfCounters hw(profile);
+    const PerfCounters *counters = profile ? &hw : NULL;
+    
     CharacterVector family(as<CharacterVector>(family_));
     ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
     
@@ -136,9 +444,35 @@ BEGIN_RCPP
         }
     }
     
+    if (parallel == "none" && family(0) == "gaussian" && n > 2 * p && gram == "packed")
+        return admm_lasso_packed(datX, datY, penalty_factor, lambda, standardize, intercept,
+                                 nlambda_, lmin_ratio_, nthreads, maxit, eps_abs, eps_rel, rho,
+                                 record, clock, counters, &deadline);
+    if (parallel == "none" && family(0) == "gaussian" && n > 2 * p)
+        return admm_lasso_tall(datX, datY, penalty_factor, lambda, standardize, intercept,
+                               nlambda_, lmin_ratio_, nthreads, maxit, eps_abs, eps_rel, rho,
+                               record, clock, counters, &deadline);
+    
     DataStd<double> datstd(n, p + add, standardize, intercept);
     datstd.standardize(datX, datY);
     
+    if (parallel == "rows" && family(0) == "gaussian")
+    {
+        if (precision == "single")
+            return admm_lasso_rows<float>(datX, datY, penalty_factor, lambda, datstd,
+                                          nlambda_, lmin_ratio_, nthreads, processes,
+                                          maxit, eps_abs, eps_rel, rho, record, clock, counters,
+                                          &deadline);
+        return admm_lasso_rows<double>(datX, datY, penalty_factor, lambda, datstd,
+                                       nlambda_, lmin_ratio_, nthreads, processes,
+                                       maxit, eps_abs, eps_rel, rho, record, clock, counters,
+                                       &deadline);
+    }
+    if (parallel == "columns" && family(0) == "gaussian")
+        return admm_lasso_columns(datX, datY, penalty_factor, lambda, datstd,
+                                  nlambda_, lmin_ratio_, nthreads, maxit, eps_abs, eps_rel, rho,
+                                  record, clock, counters, &deadline);
+    
     // initialize pointers 
     FADMMBase<Eigen::VectorXd, Eigen::SparseVector<double>, Eigen::VectorXd> *solver_tall = NULL; // obj doesn't point to anything yet
     ADMMBase<Eigen::SparseVector<double>, Eigen::VectorXd, Eigen::VectorXd> *solver_wide = NULL; // obj doesn't point to anything yet
@@ -149,10 +483,8 @@ BEGIN_RCPP
     // initialize classes
     if(n > 2 * p)
     {
-        if (family(0) == "gaussian")
-        {
-            solver_tall = new ADMMLassoTall(datX, datY, penalty_factor, eps_abs, eps_rel);
-        } else if (family(0) == "binomial")
+        // the gaussian fits for tall X returned above
+        if (family(0) == "binomial")
         {
             solver_tall = new ADMMLassoLogisticTall(datX, datY, penalty_factor, irls_tol, irls_maxit, eps_abs, eps_rel);
         }
@@ -192,17 +524,38 @@ BEGIN_RCPP
     beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
 
     IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
     double ilambda = 0.0;
 
+    SolverTelemetry telemetry(record ? nlambda : 0, counters);
+    SolverTelemetry *recorded = record ? &telemetry : NULL;
+    if(n > 2 * p)
+    {
+        solver_tall->set_telemetry(recorded);
+        solver_tall->set_deadline(&deadline);
+    } else
+    {
+        solver_wide->set_telemetry(recorded);
+        solver_wide->set_deadline(&deadline);
+    }
+    if (recorded)
+        recorded->add_setup(clock.seconds());
+
     for(int i = 0; i < nlambda; i++)
     {
         ilambda = lambda[i] * n / datstd.get_scaleY();
+        if (recorded)
+            recorded->begin(i);
         if(n > 2 * p)
         {
-            if(i == 0)
-                solver_tall->init(ilambda, rho);
-            else
-                solver_tall->init_warm(ilambda);
+            {
+                SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+                if(i == 0)
+                    solver_tall->init(ilambda, rho);
+                else
+                    solver_tall->init_warm(ilambda);
+            }
 
             niter[i] = solver_tall->solve(maxit);
             SpVec res = solver_tall->get_gamma();
@@ -211,13 +564,23 @@ BEGIN_RCPP
             {
                 datstd.recover(beta0, res);
             }
+            if (deadline.stopped())
+            {
+                partial = partial_fit(deadline, lambda[i], niter[i], solver_tall->get_resid_primal(),
+                                      solver_tall->get_resid_dual(), beta_vector(p, beta0, res, fullbetamat));
+                nfit = i;
+                break;
+            }
             write_beta_matrix(beta, i, beta0, res, fullbetamat);
         } else {
             
-            if(i == 0)
-                solver_wide->init(ilambda, rho);
-            else
-                solver_wide->init_warm(ilambda, i);
+            {
+                SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+                if(i == 0)
+                    solver_wide->init(ilambda, rho);
+                else
+                    solver_wide->init_warm(ilambda, i);
+            }
 
             niter[i] = solver_wide->solve(maxit);
             SpVec res = solver_wide->get_beta();
@@ -226,6 +589,13 @@ BEGIN_RCPP
             {
                 datstd.recover(beta0, res);
             }
+            if (deadline.stopped())
+            {
+                partial = partial_fit(deadline, lambda[i], niter[i], solver_wide->get_resid_primal(),
+                                      solver_wide->get_resid_dual(), beta_vector(p, beta0, res, fullbetamat));
+                nfit = i;
+                break;
+            }
             write_beta_matrix(beta, i, beta0, res, fullbetamat);
             
         }
@@ -243,9 +613,425 @@ BEGIN_RCPP
 
     beta.makeCompressed();
 
-    return List::create(Named("lambda") = lambda,
+    return path_result(lambda, beta, niter, recorded, nfit, partial);
+
+END_RCPP
+}
+
+
+// gaussian admm_lasso for a design prepared by prepare_design(), with
+// the standardization chosen there. in the tall case the fits reuse
+// the eigenvalue of X'X and the factorizations of X'X + rho * I
+// cached in the design, in the wide case the eigenvalue of XX'
+RcppExport SEXP admm_lasso_prepared(SEXP design_, 
+                                    SEXP y_, 
+                                    SEXP lambda_,
+                                    SEXP nlambda_, 
+                                    SEXP lmin_ratio_,
+                                    SEXP penalty_factor_,
+                                    SEXP opts_)
+{
+BEGIN_RCPP
+    
+    const WallClock clock;
+    Rcpp::XPtr<PreparedDesign> design(design_);
+    Rcpp::NumericVector yy(y_);
+    
+    const int n = design->n;
+    const int p = design->p;
+    
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    int nlambda = lambda.size();
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double eps_abs   = as<double>(opts["eps_abs"]);
+    const double eps_rel   = as<double>(opts["eps_rel"]);
+    const double rho       = as<double>(opts["rho"]);
+    const bool profile     = as<bool>(opts["counters"]);
+    const bool record      = profile || as<bool>(opts["telemetry"]);
+    SolveDeadline deadline(as<double>(opts["time_limit"]), as<bool>(opts["interruptible"]),
+                           clock.seconds());
+    
+    // opened before the solver starts its threads or processes, which
+    // are counted with this one
+    PerfCounters hw(profile);
+    const PerfCounters *counters = profile ? &hw : NULL;
+    
+    VectorXd datY;
+    DataStd<double> datstd = design->standardize_response(yy.begin(), datY);
+    
+    ADMMLassoTallPrepared *solver_tall = NULL;
+    ADMMLassoWide *solver_wide = NULL;
+    
+    if(n > 2 * p)
+        solver_tall = new ADMMLassoTallPrepared(*design, datY, penalty_factor, eps_abs, eps_rel);
+    else
+        solver_wide = new ADMMLassoWide(design->X, datY, penalty_factor, eps_abs, eps_rel,
+                                        design->max_eigenvalue());
+    
+    if (nlambda < 1) {
+        
+        double lmax = (n > 2 * p) ? solver_tall->get_lambda_zero() : solver_wide->get_lambda_zero();
+        lmax = lmax / n * datstd.get_scaleY();
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    SpMat beta(p + 1, nlambda);
+    beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
+    
+    SolverTelemetry telemetry(record ? nlambda : 0, counters);
+    SolverTelemetry *recorded = record ? &telemetry : NULL;
+    if(n > 2 * p)
+    {
+        solver_tall->set_telemetry(recorded);
+        solver_tall->set_deadline(&deadline);
+    } else
+    {
+        solver_wide->set_telemetry(recorded);
+        solver_wide->set_deadline(&deadline);
+    }
+    if (recorded)
+        recorded->add_setup(clock.seconds());
+    
+    for(int i = 0; i < nlambda; i++)
+    {
+        double ilambda = lambda[i] * n / datstd.get_scaleY();
+        if (recorded)
+            recorded->begin(i);
+        SpVec res;
+        double resid_primal, resid_dual;
+        if(n > 2 * p)
+        {
+            {
+                SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+                if(i == 0)
+                    solver_tall->init(ilambda, rho);
+                else
+                    solver_tall->init_warm(ilambda);
+            }
+            
+            niter[i] = solver_tall->solve(maxit);
+            res = solver_tall->get_gamma();
+            resid_primal = solver_tall->get_resid_primal();
+            resid_dual = solver_tall->get_resid_dual();
+        } else {
+            {
+                SolverTelemetry::Timer timer(recorded, SolverTelemetry::SETUP);
+                if(i == 0)
+                    solver_wide->init(ilambda, rho);
+                else
+                    solver_wide->init_warm(ilambda, i);
+            }
+            
+            niter[i] = solver_wide->solve(maxit);
+            res = solver_wide->get_beta();
+            resid_primal = solver_wide->get_resid_primal();
+            resid_dual = solver_wide->get_resid_dual();
+        }
+        double beta0 = 0.0;
+        datstd.recover(beta0, res);
+        if (deadline.stopped())
+        {
+            partial = partial_fit(deadline, lambda[i], niter[i], resid_primal, resid_dual,
+                                  beta_vector(p, beta0, res, false));
+            nfit = i;
+            break;
+        }
+        write_beta_matrix(beta, i, beta0, res, false);
+    }
+    
+    delete solver_tall;
+    delete solver_wide;
+    
+    beta.makeCompressed();
+    
+    return path_result(lambda, beta, niter, recorded, nfit, partial);
+    
+END_RCPP
+}
+
+// gaussian admm_lasso for an n x p matrix in a binary file of doubles,
+// column-major (as written by writeBin(c(x))) or row-major. the file is
+// memory mapped and read once in blocks of rows to accumulate the
+// standardized X'X and X'y (StreamGram.h), which is all the tall solver
+// uses, so at most one block of rows is in memory at a time. y is
+// either a numeric vector or the name of a binary file of n doubles
+RcppExport SEXP admm_lasso_stream(SEXP x_file_, 
+                                  SEXP y_, 
+                                  SEXP n_,
+                                  SEXP p_,
+                                  SEXP row_major_,
+                                  SEXP block_rows_,
+                                  SEXP lambda_,
+                                  SEXP nlambda_, 
+                                  SEXP lmin_ratio_,
+                                  SEXP penalty_factor_,
+                                  SEXP standardize_, 
+                                  SEXP intercept_,
+                                  SEXP opts_)
+{
+BEGIN_RCPP
+    
+    const int n = as<int>(n_);
+    const int p = as<int>(p_);
+    const bool row_major = as<bool>(row_major_);
+    int block_rows = as<int>(block_rows_);
+    
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double eps_abs   = as<double>(opts["eps_abs"]);
+    const double eps_rel   = as<double>(opts["eps_rel"]);
+    const double rho       = as<double>(opts["rho"]);
+    const bool standardize = as<bool>(standardize_);
+    const bool intercept   = as<bool>(intercept_);
+    
+    // blocks of about 2^23 doubles (64MB) by default
+    if (block_rows <= 0)
+        block_rows = std::max(1, (1 << 23) / p);
+    
+    // the files are unmapped once the statistics are accumulated
+    StreamGram stats(p, standardize, intercept);
+    {
+        MappedFile xfile(as<std::string>(x_file_), size_t(n) * p);
+        if (TYPEOF(y_) == STRSXP)
+        {
+            MappedFile yfile(as<std::string>(y_), n);
+            stats.accumulate(xfile, n, row_major, yfile.data(), block_rows);
+        } else {
+            Rcpp::NumericVector yy(y_);
+            stats.accumulate(xfile, n, row_major, yy.begin(), block_rows);
+        }
+    }
+    
+    MatrixXd XX;
+    VectorXd XY;
+    DataStd<double> datstd = stats.standardized(XX, XY);
+    ADMMLassoTallStream solver(XX, XY, penalty_factor, eps_abs, eps_rel);
+    return admm_lasso_gram_path(solver, datstd, n, p, lambda,
+                                nlambda_, lmin_ratio_, maxit, rho,
+                                false, WallClock(), NULL, NULL);
+    
+END_RCPP
+}
+
+// an empty gaussian lasso model for rows that arrive in batches, see
+// ADMMLassoTallOnline.h. rows are added and the path is fitted by
+// admm_lasso_online_append(). the model is freed when the pointer
+// is garbage collected
+RcppExport SEXP admm_lasso_online_new(SEXP p_, 
+                                      SEXP penalty_factor_,
+                                      SEXP standardize_, 
+                                      SEXP intercept_,
+                                      SEXP opts_)
+{
+BEGIN_RCPP
+    
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    List opts(opts_);
+    const double eps_abs   = as<double>(opts["eps_abs"]);
+    const double eps_rel   = as<double>(opts["eps_rel"]);
+    const double rho       = as<double>(opts["rho"]);
+    
+    ADMMLassoTallOnline *model = new ADMMLassoTallOnline(as<int>(p_), penalty_factor,
+                                                         as<bool>(standardize_), as<bool>(intercept_),
+                                                         rho, eps_abs, eps_rel);
+    
+    return Rcpp::XPtr<ADMMLassoTallOnline>(model, true);
+    
+END_RCPP
+}
+
+// adds the rows of x and y to an online model and fits the lambda path
+// on all the rows so far, starting from the previous fit. the path is
+// set by the first call, from lambda or as nlambda values down from the
+// largest lambda, and lambda_, nlambda_ and lmin_ratio_ are ignored after
+RcppExport SEXP admm_lasso_online_append(SEXP model_, 
+                                         SEXP x_, 
+                                         SEXP y_, 
+                                         SEXP lambda_,
+                                         SEXP nlambda_, 
+                                         SEXP lmin_ratio_,
+                                         SEXP maxit_)
+{
+BEGIN_RCPP
+    
+    Rcpp::XPtr<ADMMLassoTallOnline> model(model_);
+    Rcpp::NumericMatrix xx(x_);
+    Rcpp::NumericVector yy(y_);
+    
+    const int p = xx.cols();
+    const int maxit = as<int>(maxit_);
+    
+    DataStd<double> datstd = model->append(MapMatd(xx.begin(), xx.rows(), p), yy.begin());
+    const int n = model->nobs();
+    
+    if (model->path.size() < 1)
+    {
+        ArrayXd lambda(as<ArrayXd>(lambda_));
+        if (lambda.size() < 1)
+        {
+            double lmax = model->get_lambda_zero() / n * datstd.get_scaleY();
+            double lmin = as<double>(lmin_ratio_) * lmax;
+            lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+            lambda = lambda.exp();
+        }
+        model->set_path(lambda);
+    }
+    
+    const int nlambda = model->path.size();
+    SpMat beta(p + 1, nlambda);
+    beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    IntegerVector niter(nlambda);
+    
+    for(int i = 0; i < nlambda; i++)
+    {
+        double ilambda = model->path[i] * n / datstd.get_scaleY();
+        niter[i] = model->fit(i, ilambda, maxit);
+        SpVec res = model->get_gamma();
+        double beta0 = 0.0;
+        datstd.recover(beta0, res);
+        write_beta_matrix(beta, i, beta0, res, false);
+    }
+    
+    beta.makeCompressed();
+    
+    return List::create(Named("lambda") = model->path,
                         Named("beta") = beta,
                         Named("niter") = niter);
+    
+END_RCPP
+}
 
+// K-fold cross-validation for the gaussian tall case of admm_lasso.
+// foldid holds the fold (1, ..., nfolds) of each row. X'X is computed
+// once, the training Gram matrix of each fold is X'X minus the
+// contribution of its held-out rows and, for unscaled columns, the
+// training factorizations are downdates of one factorization over
+// all rows. returns the out-of-fold predictions, an N x nlambda matrix
+RcppExport SEXP cv_admm_lasso(SEXP x_, 
+                              SEXP y_, 
+                              SEXP lambda_,
+                              SEXP penalty_factor_,
+                              SEXP foldid_,
+                              SEXP standardize_, 
+                              SEXP intercept_,
+                              SEXP opts_)
+{
+BEGIN_RCPP
+    
+    Rcpp::NumericMatrix xx(x_);
+    Rcpp::NumericVector yy(y_);
+    IntegerVector foldid(foldid_);
+    
+    const int n = xx.rows();
+    const int p = xx.cols();
+    
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    const int nlambda = lambda.size();
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double eps_abs   = as<double>(opts["eps_abs"]);
+    const double eps_rel   = as<double>(opts["eps_rel"]);
+    double rho             = as<double>(opts["rho"]);
+    const bool standardize = as<bool>(standardize_);
+    const bool intercept   = as<bool>(intercept_);
+    
+    // order the rows by fold, so that the held-out rows
+    // of each fold are a contiguous block
+    std::vector<int> order, fold_start;
+    const int nfolds = fold_order(foldid.begin(), n, order, fold_start);
+    
+    MatrixXd datX(n, p);
+    VectorXd datY(n);
+    for (int j = 0; j < p; j++)
+    {
+        const double *xcol = &xx[j * n];
+        for (int i = 0; i < n; i++)
+            datX(i, j) = xcol[order[i]];
+    }
+    for (int i = 0; i < n; i++)
+        datY(i) = yy[order[i]];
+    
+    MatrixXd XX(XtX(datX));
+    std::vector<CVFold*> folds;
+    make_folds(datX, datY, fold_start, standardize, intercept, folds);
+    
+    // n_k + 1 rank one downdates cost about 2 * (n_k + 1) * p^2 flops,
+    // against p^3 / 3 for a new factorization
+    int nhold_max = 0;
+    for (int k = 0; k < nfolds; k++)
+        nhold_max = std::max(nhold_max, fold_start[k + 1] - fold_start[k]);
+    const bool downdate = !standardize && 6 * (nhold_max + 1) < p;
+    Eigen::LDLT<MatrixXd> base_solver;
+    
+    MatrixXd preds(n, nlambda);
+    
+    for (int k = 0; k < nfolds; k++)
+    {
+        CVFold &fold = *folds[k];
+        const double scaleY = fold.datstd.get_scaleY();
+        
+        // all folds share the rho of the first fold, so that
+        // they can share the factorization over all rows
+        ADMMLassoTallCV solver(fold, XX, penalty_factor,
+                               (downdate && k > 0) ? &base_solver : NULL, rho,
+                               eps_abs, eps_rel);
+        
+        for (int i = 0; i < nlambda; i++)
+        {
+            double ilambda = lambda[i] * fold.nobs / scaleY;
+            if (i == 0)
+                solver.init(ilambda, rho);
+            else
+                solver.init_warm(ilambda);
+            
+            solver.solve(maxit);
+            VectorXd res = solver.get_gamma();
+            double beta0 = 0.0;
+            fold.datstd.recover(beta0, res);
+            fold.predict(res, beta0, &preds(fold_start[k], i));
+        }
+        
+        if (k == 0)
+        {
+            rho = solver.get_rho();
+            if (downdate)
+            {
+                MatrixXd matToSolve(XX);
+                matToSolve.diagonal().array() += rho;
+                base_solver.compute(matToSolve.selfadjointView<Eigen::Lower>());
+            }
+        }
+    }
+    
+    for (int k = 0; k < nfolds; k++)
+        delete folds[k];
+    
+    // back to the original row order
+    Rcpp::NumericMatrix pred(n, nlambda);
+    for (int i = 0; i < nlambda; i++)
+    {
+        for (int r = 0; r < n; r++)
+            pred(order[r], i) = preds(r, i);
+    }
+    
+    return pred;
+    
 END_RCPP
 }
@@ -1,5 +1,7 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "ADMMLassoTallPrecond.h"
 #include "ADMMLassoLogisticTall.h"
 #include "ADMMLassoWide.h"
@@ -41,6 +43,21 @@ inline void write_beta_matrix(SpMat &betas, int col, double beta0, SpVec &coef,
     }
 }
 
+// the coefficients of a fit as written by write_beta_matrix()
+inline VectorXd beta_vector(int p, double beta0, const SpVec &coef, bool startatzero)
+{
+    VectorXd res = VectorXd::Zero(p + 1);
+    int add = 0;
+    if (!startatzero)
+    {
+        add = 1;
+        res[0] = beta0;
+    }
+    for(SpVec::InnerIterator iter(coef); iter; ++iter)
+        res[iter.index() + add] = iter.value();
+    return res;
+}
+
 RcppExport SEXP admm_lasso_precond(SEXP x_, 
                                    SEXP y_, 
                                    SEXP family_,
@@ -54,6 +71,9 @@ RcppExport SEXP admm_lasso_precond(SEXP x_,
 {
 BEGIN_RCPP
 
+    // the time limit counts from here
+    const WallClock clock;
+
     //Rcpp::NumericMatrix xx(x_);
     //Rcpp::NumericVector yy(y_);
     
@@ -99,6 +119,8 @@ BEGIN_RCPP
     const double eps_abs   = as<double>(opts["eps_abs"]);
     const double eps_rel   = as<double>(opts["eps_rel"]);
     const double rho       = as<double>(opts["rho"]);
+    SolveDeadline deadline(as<double>(opts["time_limit"]), as<bool>(opts["interruptible"]),
+                           clock.seconds());
     bool standardize   = as<bool>(standardize_);
     bool intercept     = as<bool>(intercept_);
     bool intercept_bin = intercept;
@@ -178,8 +200,15 @@ BEGIN_RCPP
     beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
 
     IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
     double ilambda = 0.0;
 
+    if(n > 2 * p)
+        solver_tall->set_deadline(&deadline);
+    else
+        solver_wide->set_deadline(&deadline);
+
     for(int i = 0; i < nlambda; i++)
     {
         ilambda = lambda[i] * n / datstd.get_scaleY();
@@ -197,6 +226,13 @@ BEGIN_RCPP
             {
                 datstd.recover(beta0, res);
             }
+            if (deadline.stopped())
+            {
+                partial = partial_fit(deadline, lambda[i], niter[i], solver_tall->get_resid_primal(),
+                                      solver_tall->get_resid_dual(), beta_vector(p, beta0, res, fullbetamat));
+                nfit = i;
+                break;
+            }
             write_beta_matrix(beta, i, beta0, res, fullbetamat);
         } else {
             
@@ -212,6 +248,13 @@ BEGIN_RCPP
             {
                 datstd.recover(beta0, res);
             }
+            if (deadline.stopped())
+            {
+                partial = partial_fit(deadline, lambda[i], niter[i], solver_wide->get_resid_primal(),
+                                      solver_wide->get_resid_dual(), beta_vector(p, beta0, res, fullbetamat));
+                nfit = i;
+                break;
+            }
             write_beta_matrix(beta, i, beta0, res, fullbetamat);
             
         }
@@ -229,9 +272,7 @@ BEGIN_RCPP
 
     beta.makeCompressed();
 
-    return List::create(Named("lambda") = lambda,
-                        Named("beta") = beta,
-                        Named("niter") = niter);
+    return path_result(lambda, beta, niter, NULL, nfit, partial);
 
 END_RCPP
 }
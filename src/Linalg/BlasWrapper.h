@@ -30,6 +30,9 @@ extern "C"
     void dsyrk_(const char* uplo, const char* transA, const int* n, const int* k,
                 const double* alpha, const double* A, const int* ldA,
                 const double* beta, double* C, const int* ldC);
+    void dspmv_(const char *uplo, const int *n, const double *alpha,
+                const double *ap, const double *x, const int *incx,
+                const double *beta, double *y, const int *incy);
     void ssyrk_(const char* uplo, const char* transA, const int* n, const int* k,
                 const float* alpha, const float* A, const int* ldA,
                 const float* beta, float* C, const int* ldC);
@@ -90,24 +93,60 @@ inline void mat_vec_tprod(Eigen::VectorXd &res, ConstGenericMatrix &X, ConstGene
 
 
 
-// Wrappers for Level 3
-
-// Calculating X'X
-inline void cross_prod_lower(Eigen::MatrixXd &res, ConstGenericMatrix &X)
+// y = A * x for a symmetric A in packed storage (lower triangle)
+inline void packed_mat_vec_prod(double *y, const double *ap, const double *x, const int n)
 {
     const double one = 1.0;
     const double zero = 0.0;
+    const int inc = 1;
+
+    dspmv_("L", &n, &one, ap, x, &inc, &zero, y, &inc);
+}
+
+
+
+// Wrappers for Level 3
 
+// The lower triangle of alpha * X'X + beta * res, with res given by
+// its first element and leading dimension, e.g. a block of a matrix
+inline void cross_prod_lower(double *res, const int ldres, ConstGenericMatrix &X,
+                             const double &alpha = 1.0, const double &beta = 0.0)
+{
     const int n = X.rows();
     const int p = X.cols();
-    const double *x_ptr = X.data();
-
-    res.resize(p, p);
-    double *res_ptr = res.data();
+    const int ldx = X.outerStride();
 
     dsyrk_("L", "T", &p, &n,
-           &one, x_ptr, &n,
-           &zero, res_ptr, &p);
+           &alpha, X.data(), &ldx,
+           &beta, res, &ldres);
+}
+
+// Calculating X'X, or res = alpha * X'X + beta * res
+// (e.g. accumulating over blocks of rows) if beta != 0
+inline void cross_prod_lower(Eigen::MatrixXd &res, ConstGenericMatrix &X,
+                             const double &alpha = 1.0, const double &beta = 0.0)
+{
+    const int p = X.cols();
+
+    if (beta == 0.0)
+        res.resize(p, p);
+
+    cross_prod_lower(res.data(), p, X, alpha, beta);
+}
+
+// res = alpha * A'B + beta * res, with res given as above
+inline void cross_prod(double *res, const int ldres, ConstGenericMatrix &A, ConstGenericMatrix &B,
+                       const double &alpha = 1.0, const double &beta = 0.0)
+{
+    const int n = A.rows();
+    const int m = A.cols();
+    const int k = B.cols();
+    const int lda = A.outerStride();
+    const int ldb = B.outerStride();
+
+    dgemm_("T", "N", &m, &k, &n,
+           &alpha, A.data(), &lda, B.data(), &ldb,
+           &beta, res, &ldres);
 }
 inline void cross_prod_lower(Eigen::MatrixXf &res, ConstGenericMatrixf &X)
 {
@@ -126,22 +165,22 @@ inline void cross_prod_lower(Eigen::MatrixXf &res, ConstGenericMatrixf &X)
            &zero, res_ptr, &p);
 }
 
-// Calculating XX'
-inline void tcross_prod_lower(Eigen::MatrixXd &res, ConstGenericMatrix &X)
+// Calculating XX', or res = alpha * XX' + beta * res if beta != 0
+inline void tcross_prod_lower(Eigen::MatrixXd &res, ConstGenericMatrix &X,
+                              const double &alpha = 1.0, const double &beta = 0.0)
 {
-    const double one = 1.0;
-    const double zero = 0.0;
-
     const int n = X.rows();
     const int p = X.cols();
+    const int ldx = X.outerStride();
     const double *x_ptr = X.data();
 
-    res.resize(n, n);
+    if (beta == 0.0)
+        res.resize(n, n);
     double *res_ptr = res.data();
 
     dsyrk_("L", "N", &n, &p,
-           &one, x_ptr, &n,
-           &zero, res_ptr, &n);
+           &alpha, x_ptr, &ldx,
+           &beta, res_ptr, &n);
 }
 inline void tcross_prod_lower(Eigen::MatrixXf &res, ConstGenericMatrixf &X)
 {
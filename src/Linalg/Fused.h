@@ -0,0 +1,270 @@
+#ifndef FUSED_H
+#define FUSED_H
+
+// Level 1 kernels for the coordinate descent inner loops.
+//
+// A naive coordinate descent sweep computes x_j'r and then, if beta_j
+// changes, r -= delta * x_j, so r is streamed from memory twice per
+// coordinate. axpy_dot() fuses the residual update of coordinate j
+// with the inner product x_{j+1}'r of the next coordinate, so r is read
+// and written once per coordinate.
+//
+// The AVX2/FMA and AVX-512 versions are compiled with target attributes
+// and chosen at runtime, so the package itself does not need to be
+// compiled with -mavx2.
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINALG_FUSED_X86
+#include <immintrin.h>
+#endif
+
+namespace Linalg {
+
+namespace fused_detail {
+
+inline double dot_generic(const double *x, const double *y, int n)
+{
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i = 0;
+    for( ; i + 4 <= n; i += 4)
+    {
+        s0 += x[i] * y[i];
+        s1 += x[i + 1] * y[i + 1];
+        s2 += x[i + 2] * y[i + 2];
+        s3 += x[i + 3] * y[i + 3];
+    }
+    for( ; i < n; i++)
+        s0 += x[i] * y[i];
+    return (s0 + s1) + (s2 + s3);
+}
+
+// y += alpha * x, returns z'y for the updated y
+inline double axpy_dot_generic(int n, double alpha, const double *x, double *y, const double *z)
+{
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i = 0;
+    for( ; i + 4 <= n; i += 4)
+    {
+        y[i] += alpha * x[i];
+        y[i + 1] += alpha * x[i + 1];
+        y[i + 2] += alpha * x[i + 2];
+        y[i + 3] += alpha * x[i + 3];
+        s0 += z[i] * y[i];
+        s1 += z[i + 1] * y[i + 1];
+        s2 += z[i + 2] * y[i + 2];
+        s3 += z[i + 3] * y[i + 3];
+    }
+    for( ; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+        s0 += z[i] * y[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+#ifdef LINALG_FUSED_X86
+
+__attribute__((target("avx2,fma")))
+inline double hsum_avx2(__m256d s)
+{
+    __m128d lo = _mm256_castpd256_pd128(s);
+    __m128d hi = _mm256_extractf128_pd(s, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+inline double dot_avx2(const double *x, const double *y, int n)
+{
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    int i = 0;
+    for( ; i + 16 <= n; i += 16)
+    {
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i),      _mm256_loadu_pd(y + i),      s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4),  _mm256_loadu_pd(y + i + 4),  s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 8),  _mm256_loadu_pd(y + i + 8),  s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12), s3);
+    }
+    for( ; i + 4 <= n; i += 4)
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+    double r = hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for( ; i < n; i++)
+        r += x[i] * y[i];
+    return r;
+}
+
+__attribute__((target("avx2,fma")))
+inline double axpy_dot_avx2(int n, double alpha, const double *x, double *y, const double *z)
+{
+    const __m256d a = _mm256_set1_pd(alpha);
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    __m256d s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+    __m256d y0, y1, y2, y3;
+    int i = 0;
+    for( ; i + 16 <= n; i += 16)
+    {
+        y0 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i),      _mm256_loadu_pd(y + i));
+        y1 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 4),  _mm256_loadu_pd(y + i + 4));
+        y2 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 8),  _mm256_loadu_pd(y + i + 8));
+        y3 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i + 12), _mm256_loadu_pd(y + i + 12));
+        _mm256_storeu_pd(y + i, y0);
+        _mm256_storeu_pd(y + i + 4, y1);
+        _mm256_storeu_pd(y + i + 8, y2);
+        _mm256_storeu_pd(y + i + 12, y3);
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(z + i),      y0, s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(z + i + 4),  y1, s1);
+        s2 = _mm256_fmadd_pd(_mm256_loadu_pd(z + i + 8),  y2, s2);
+        s3 = _mm256_fmadd_pd(_mm256_loadu_pd(z + i + 12), y3, s3);
+    }
+    for( ; i + 4 <= n; i += 4)
+    {
+        y0 = _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+        _mm256_storeu_pd(y + i, y0);
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(z + i), y0, s0);
+    }
+    double r = hsum_avx2(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+    for( ; i < n; i++)
+    {
+        y[i] += alpha * x[i];
+        r += z[i] * y[i];
+    }
+    return r;
+}
+
+__attribute__((target("avx512f")))
+inline double dot_avx512(const double *x, const double *y, int n)
+{
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    int i = 0;
+    for( ; i + 32 <= n; i += 32)
+    {
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i),      _mm512_loadu_pd(y + i),      s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8),  _mm512_loadu_pd(y + i + 8),  s1);
+        s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16), s2);
+        s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24), s3);
+    }
+    for( ; i + 8 <= n; i += 8)
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+    // the remaining < 8 elements with a masked load
+    if(i < n)
+    {
+        const __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i), s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+__attribute__((target("avx512f")))
+inline double axpy_dot_avx512(int n, double alpha, const double *x, double *y, const double *z)
+{
+    const __m512d a = _mm512_set1_pd(alpha);
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+    __m512d y0, y1, y2, y3;
+    int i = 0;
+    for( ; i + 32 <= n; i += 32)
+    {
+        y0 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i),      _mm512_loadu_pd(y + i));
+        y1 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i + 8),  _mm512_loadu_pd(y + i + 8));
+        y2 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i + 16), _mm512_loadu_pd(y + i + 16));
+        y3 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i + 24), _mm512_loadu_pd(y + i + 24));
+        _mm512_storeu_pd(y + i, y0);
+        _mm512_storeu_pd(y + i + 8, y1);
+        _mm512_storeu_pd(y + i + 16, y2);
+        _mm512_storeu_pd(y + i + 24, y3);
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(z + i),      y0, s0);
+        s1 = _mm512_fmadd_pd(_mm512_loadu_pd(z + i + 8),  y1, s1);
+        s2 = _mm512_fmadd_pd(_mm512_loadu_pd(z + i + 16), y2, s2);
+        s3 = _mm512_fmadd_pd(_mm512_loadu_pd(z + i + 24), y3, s3);
+    }
+    for( ; i + 8 <= n; i += 8)
+    {
+        y0 = _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i));
+        _mm512_storeu_pd(y + i, y0);
+        s0 = _mm512_fmadd_pd(_mm512_loadu_pd(z + i), y0, s0);
+    }
+    if(i < n)
+    {
+        const __mmask8 m = (__mmask8)((1u << (n - i)) - 1);
+        y0 = _mm512_fmadd_pd(a, _mm512_maskz_loadu_pd(m, x + i), _mm512_maskz_loadu_pd(m, y + i));
+        _mm512_mask_storeu_pd(y + i, m, y0);
+        s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, z + i), y0, s1);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+}
+
+#endif // LINALG_FUSED_X86
+
+typedef double (*DotFun)(const double *, const double *, int);
+typedef double (*AxpyDotFun)(int, double, const double *, double *, const double *);
+
+// 0: generic, 1: AVX2 + FMA, 2: AVX-512
+inline int simd_level()
+{
+#ifdef LINALG_FUSED_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+        return 2;
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return 1;
+#endif
+    return 0;
+}
+
+inline DotFun select_dot()
+{
+#ifdef LINALG_FUSED_X86
+    switch(simd_level())
+    {
+        case 2:
+            return dot_avx512;
+        case 1:
+            return dot_avx2;
+        default:
+            break;
+    }
+#endif
+    return dot_generic;
+}
+
+inline AxpyDotFun select_axpy_dot()
+{
+#ifdef LINALG_FUSED_X86
+    switch(simd_level())
+    {
+        case 2:
+            return axpy_dot_avx512;
+        case 1:
+            return axpy_dot_avx2;
+        default:
+            break;
+    }
+#endif
+    return axpy_dot_generic;
+}
+
+} // namespace fused_detail
+
+
+
+// x'y
+inline double dot(const double *x, const double *y, const int n)
+{
+    // selected once, on first use
+    static const fused_detail::DotFun fun = fused_detail::select_dot();
+    return fun(x, y, n);
+}
+
+// y = y + alpha * x, and returns z'y for the updated y
+inline double axpy_dot(const int n, const double alpha, const double *x, double *y, const double *z)
+{
+    static const fused_detail::AxpyDotFun fun = fused_detail::select_axpy_dot();
+    return fun(n, alpha, x, y, z);
+}
+
+
+} // namespace Linalg
+
+#endif // FUSED_H
@@ -0,0 +1,204 @@
+#ifndef GRAM_H
+#define GRAM_H
+
+#include <Eigen/Core>
+#include <vector>
+#include <algorithm>
+#include "BlasWrapper.h"
+#include "LapackWrapper.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Linalg {
+
+
+
+// The lower triangle of a symmetric p x p matrix in LAPACK packed
+// storage: column j holds the rows j, ..., p - 1, so the matrix takes
+// p * (p + 1) / 2 doubles instead of p * p
+class PackedSym
+{
+private:
+    typedef Eigen::MatrixXd Matrix;
+    typedef Eigen::VectorXd Vector;
+
+    int p;
+    std::vector<double> ap;
+
+public:
+    PackedSym() : p(0) {}
+
+    explicit PackedSym(int p_) :
+        p(p_), ap(size_t(p_) * (p_ + 1) / 2, 0.0)
+    {}
+
+    int rows() const { return p; }
+    int cols() const { return p; }
+
+    void resize(int p_)
+    {
+        p = p_;
+        ap.assign(size_t(p_) * (p_ + 1) / 2, 0.0);
+    }
+
+    double *data() { return ap.empty() ? NULL : &ap[0]; }
+    const double *data() const { return ap.empty() ? NULL : &ap[0]; }
+
+    // the element (j, j), followed by (j + 1, j), ..., (p - 1, j)
+    double *col(int j) { return data() + (size_t(j) * (2 * p - j + 1)) / 2; }
+    const double *col(int j) const { return data() + (size_t(j) * (2 * p - j + 1)) / 2; }
+
+    // the element (i, j) of the symmetric matrix
+    double coeff(int i, int j) const
+    {
+        return (i >= j) ? col(j)[i - j] : col(i)[j - i];
+    }
+
+    void add_to_diag(double val)
+    {
+        for(int j = 0; j < p; j++)
+            col(j)[0] += val;
+    }
+
+    // res = lower triangle as a dense matrix, the upper one is zero
+    void to_dense_lower(Matrix &res) const
+    {
+        res.setZero(p, p);
+        for(int j = 0; j < p; j++)
+            std::copy(col(j), col(j) + (p - j), &res(j, j));
+    }
+
+    // y = A * x
+    void mat_vec_prod(double *y, const double *x) const
+    {
+        packed_mat_vec_prod(y, data(), x, p);
+    }
+
+    // as an operator for Spectra: y_out = A * x_in
+    void perform_op(double *x_in, double *y_out) { mat_vec_prod(y_out, x_in); }
+
+    // Cholesky factorization A = LL' in place, false if A is not
+    // positive definite
+    bool cholesky()
+    {
+        int info;
+        dpptrf_("L", &p, data(), &info);
+        return info == 0;
+    }
+
+    // solves LL'x = b in place, after cholesky()
+    void cholesky_solve(Vector &b) const
+    {
+        const int nrhs = 1;
+        int info;
+        dpptrs_("L", &p, &nrhs, data(), b.data(), &p, &info);
+    }
+};
+
+
+
+// The lower triangle of X'X for an n x p matrix X, split into blocks
+// (I, J), J <= I, of block x block elements. the blocks are independent
+// products of two panels of columns of X, dsyrk on the diagonal and
+// dgemm below it, computed in parallel by nthreads threads. each block
+// is written straight into a dense result (of leading dimension p), or
+// into a buffer of the thread and then into the columns of a PackedSym,
+// which needs half the memory of the dense one for large p
+
+// the first columns of the panels, and the blocks of the lower
+// triangle with the largest (off-diagonal) ones first
+inline void gram_blocks(int p, int block, std::vector<int> &first, std::vector< std::pair<int, int> > &tiles)
+{
+    first.clear();
+    for(int j = 0; j < p; j += block)
+        first.push_back(j);
+    first.push_back(p);
+
+    const int nb = first.size() - 1;
+    tiles.clear();
+    for(int d = nb - 1; d >= 0; d--)
+    {
+        for(int J = 0; J + d < nb; J++)
+            tiles.push_back(std::make_pair(J + d, J));
+    }
+}
+
+// block (I, J) with rows i0, ..., i0 + ni - 1 and columns j0, ..., j0 + nj - 1,
+// or the block plus beta times its current value
+inline void gram_block(double *res, int ldres, ConstGenericMatrix &X,
+                       int i0, int ni, int j0, int nj, double beta = 0.0)
+{
+    if(i0 == j0)
+        cross_prod_lower(res, ldres, X.middleCols(i0, ni), 1.0, beta);
+    else
+        cross_prod(res, ldres, X.middleCols(i0, ni), X.middleCols(j0, nj), 1.0, beta);
+}
+
+// res = X'X, lower triangle only
+inline void gram_lower(Eigen::MatrixXd &res, ConstGenericMatrix &X, int nthreads, int block = 256)
+{
+    const int p = X.cols();
+    res.setZero(p, p);
+
+    std::vector<int> first;
+    std::vector< std::pair<int, int> > tiles;
+    gram_blocks(p, block, first, tiles);
+    const int ntiles = tiles.size();
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+    #endif
+    for(int t = 0; t < ntiles; t++)
+    {
+        const int I = tiles[t].first, J = tiles[t].second;
+        const int i0 = first[I], j0 = first[J];
+        gram_block(&res(i0, j0), p, X, i0, first[I + 1] - i0, j0, first[J + 1] - j0);
+    }
+}
+
+// res = X'X in packed storage
+inline void gram_lower(PackedSym &res, ConstGenericMatrix &X, int nthreads, int block = 256)
+{
+    const int p = X.cols();
+    res.resize(p);
+
+    std::vector<int> first;
+    std::vector< std::pair<int, int> > tiles;
+    gram_blocks(p, block, first, tiles);
+    const int ntiles = tiles.size();
+
+    #ifdef _OPENMP
+    #pragma omp parallel num_threads(nthreads)
+    #endif
+    {
+        std::vector<double> buf(size_t(block) * block);
+
+        #ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+        #endif
+        for(int t = 0; t < ntiles; t++)
+        {
+            const int I = tiles[t].first, J = tiles[t].second;
+            const int i0 = first[I], ni = first[I + 1] - i0;
+            const int j0 = first[J], nj = first[J + 1] - j0;
+            gram_block(&buf[0], ni, X, i0, ni, j0, nj);
+
+            // column j0 + c of the block holds the rows i0, ..., i0 + ni - 1,
+            // only those on or below the diagonal are kept
+            for(int c = 0; c < nj; c++)
+            {
+                const int j = j0 + c;
+                const int r = (I == J) ? c : 0;
+                std::copy(&buf[size_t(c) * ni + r], &buf[size_t(c) * ni + ni], res.col(j) + (i0 + r - j));
+            }
+        }
+    }
+}
+
+
+
+} // namespace Linalg
+
+#endif // GRAM_H
@@ -10,6 +10,9 @@ extern "C"
     void dpotrf_(const char* uplo, const int* n, double* A, const int* lda, int* info);
     void dpotrs_(const char* uplo, const int* n, const int* nrhs,
                  const double* A, const int* lda, double* B, const int* ldb, int* info);
+    void dpptrf_(const char* uplo, const int* n, double* AP, int* info);
+    void dpptrs_(const char* uplo, const int* n, const int* nrhs,
+                 const double* AP, double* B, const int* ldb, int* info);
 }
 
 
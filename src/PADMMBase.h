@@ -1,8 +1,12 @@
 #ifndef PADMMBASE_H
 #define PADMMBASE_H
 
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "ConsensusTransport.h"
 #include "Linalg/BlasWrapper.h"
+#include "Telemetry.h"
+#include "Deadline.h"
 
 // Parallel ADMM by splitting observations
 //   minimize \sum loss(A_i * x - b_i) + r(x)
@@ -12,65 +16,63 @@
 //
 // x_i(p, 1), z(p, 1)
 //
-// main_x and dual_y are updated by workers, aux_z is updated by master
+// main_x and dual_y are updated by workers, aux_z is updated by master.
+// the master and the workers only exchange z, x_i + y_i / rho and a few
+// sums of squares through a ConsensusTransport, so the workers may run
+// on threads or in other processes. one round of the exchange is
+//   master:  z <- next_z(\sum_i x_i + y_i / rho), sends z
+//   workers: y_i <- y_i + rho * (x_i - z), then x_i <- next_x(z)
+// which is the usual order x, z, y of the updates with the x update of
+// the next iteration done in the same round as the y update
 //
-template<typename Scalar, typename VecTypeX, typename VecTypeZ>
-class PADMMBase_Worker
+template<typename Scalar>
+class PADMMBase_Worker: public ConsensusEndpoint
 {
 protected:
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix;
     typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
-    typedef Eigen::Map<const Matrix> MapMat;
-    typedef Eigen::Map<const Vector> MapVec;
-    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
-    typedef const Eigen::Ref<const Vector> ConstGenericVector;
+    typedef Eigen::Map<const Eigen::VectorXd> MapVecd;
 
     Matrix subA;             // (sub) data matrix sent to this worker
     Vector subb;             // (sub) response vector sent to this worker
     const int dim_main;      // length of x_i
 
-    VecTypeX main_x;         // parameters to be optimized
-    const VecTypeZ &aux_z;   // z from master, read-only for workers
+    Vector main_x;           // parameters to be optimized
     Vector dual_y;           // Lagrangian multiplier
     double comp_squared_resid_primal;  // squared norm of primal residual on this worker
     double rho;              // augmented Lagrangian parameter
 
-    // res = x in next iteration
-    virtual void next_x(VecTypeX &res) = 0;
-    // res = primal residual in next iteration
-    virtual void next_residual(Vector &res) = 0;
-    // action when rho is changed, e.g. re-factorize matrices
-    virtual void rho_changed_action() {}
+    // res = x in next iteration, z is read in place from the master
+    virtual void next_x(Vector &res, const MapVecd &z) = 0;
 
 public:
-    PADMMBase_Worker(ConstGenericMatrix &subA_, ConstGenericVector &subb_, VecTypeZ &aux_z_) :
-        subA(subA_),
-        subb(subb_),
+    // subA_ and subb_ may be of another scalar type, e.g. blocks of the
+    // double data for a float worker. the copies are allocated and
+    // written by the thread or process that constructs the worker, which
+    // places them in memory local to it (first touch)
+    template<typename MatA, typename VecB>
+    PADMMBase_Worker(const Eigen::MatrixBase<MatA> &subA_, const Eigen::MatrixBase<VecB> &subb_) :
+        subA(subA_.template cast<Scalar>()),
+        subb(subb_.template cast<Scalar>()),
         dim_main(subA.cols()),
-        main_x(dim_main),
-        aux_z(aux_z_),
-        dual_y(dim_main)
+        main_x(Vector::Zero(dim_main)),
+        dual_y(Vector::Zero(dim_main)),
+        comp_squared_resid_primal(0.0),
+        rho(1.0)
     {}
 
     virtual ~PADMMBase_Worker() {}
 
-    virtual void update_rho(double rho_)
+    void update_x(const double *z)
     {
-        rho = rho_;
-        rho_changed_action();
-    }
-
-    virtual void update_x()
-    {
-        VecTypeX newx(dim_main);
-        next_x(newx);
+        Vector newx(dim_main);
+        next_x(newx, MapVecd(z, dim_main));
         main_x.swap(newx);
     }
 
-    virtual void update_y()
+    void update_y(const double *z)
     {
-        Vector newr(dim_main);
-        next_residual(newr);
+        Vector newr = main_x - MapVecd(z, dim_main).template cast<Scalar>();
 
         comp_squared_resid_primal = newr.squaredNorm();
 
@@ -78,26 +80,38 @@ public:
         Linalg::vec_add(dual_y.data(), Scalar(rho), newr.data(), dim_main);
     }
 
-    virtual double squared_x_norm() { return main_x.squaredNorm(); }
-    virtual double squared_y_norm() { return dual_y.squaredNorm(); }
-    virtual double squared_resid_primal() { return comp_squared_resid_primal; }
+    void step(const double *z, bool update_dual)
+    {
+        if(update_dual)
+            update_y(z);
+        update_x(z);
+    }
+
+    void result(double *xu, double *stats)
+    {
+        Eigen::Map<Eigen::VectorXd>(xu, dim_main) = (main_x + dual_y / Scalar(rho)).template cast<double>();
+        stats[0] = main_x.squaredNorm();
+        stats[1] = dual_y.squaredNorm();
+        stats[2] = comp_squared_resid_primal;
+    }
 };
 
 
-template<typename Scalar, typename VecTypeX, typename VecTypeZ>
 class PADMMBase_Master
 {
 protected:
-    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
-    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::VectorXd Vector;
+    typedef Eigen::SparseVector<double> SparseVector;
 
     const int dim_main;        // dimension of main_x
     const int dim_aux;         // dimension of aux_z
     const int dim_dual;        // dimension of dual_y
     const int n_comp;          // number of components in the objective function
-    std::vector<PADMMBase_Worker<Scalar, VecTypeX, VecTypeZ> *> worker;  // each worker handles a component
+    ConsensusTransport *transport;  // the workers, set by the derived class
 
-    VecTypeZ aux_z;            // master maintains the update of z
+    SparseVector aux_z;        // master maintains the update of z
+    Vector sum_xu;             // \sum_i x_i + y_i / rho of the last round
+    double sums[3];            // \sum_i ||x_i||^2, ||y_i||^2, ||x_i - z||^2 of the last round
 
     double rho;                // augmented Lagrangian parameter
     const double eps_abs;      // absolute tolerance
@@ -109,54 +123,95 @@ protected:
     double resid_primal;       // primal residual
     double resid_dual;         // dual residual
 
-    // res = z_bar
-    virtual void next_z(VecTypeZ &res) = 0;
-    // action when rho is changed, e.g. re-factorize matrices
-    virtual void rho_changed_action() {}
+    SolverTelemetry *telemetry;  // timings of the phases, NULL if not recorded
+    SolveDeadline *deadline;     // time budget and interruption, NULL if none
 
-    // calculating eps_primal
-    virtual double compute_eps_primal()
+    // res = z_bar, from sum_xu
+    virtual void next_z(SparseVector &res) = 0;
+
+    // writes z where the workers read it
+    void publish_z()
+    {
+        double *z = transport->z();
+        std::fill(z, z + dim_aux, 0.0);
+        for(SparseVector::InnerIterator iter(aux_z); iter; ++iter)
+            z[iter.index()] = iter.value();
+    }
+
+    // one round of command on all the workers
+    void exchange(int command)
     {
-        double x_norm_collector = 0.0;
-        for(int i = 0; i < n_comp; i++)
+        transport->broadcast(command, rho);
+        transport->reduce(sum_xu, sums);
+    }
+
+    // Calculate ||v1 - v2||^2 when v1 and v2 are sparse
+    static double diff_squared_norm(const SparseVector &v1, const SparseVector &v2)
+    {
+        const int n1 = v1.nonZeros(), n2 = v2.nonZeros();
+        const double *v1_val = v1.valuePtr(), *v2_val = v2.valuePtr();
+        const int *v1_ind = v1.innerIndexPtr(), *v2_ind = v2.innerIndexPtr();
+
+        double r = 0.0;
+        int i1 = 0, i2 = 0;
+        while(i1 < n1 && i2 < n2)
         {
-            x_norm_collector += worker[i]->squared_x_norm();
+            if(v1_ind[i1] == v2_ind[i2])
+            {
+                double val = v1_val[i1] - v2_val[i2];
+                r += val * val;
+                i1++;
+                i2++;
+            } else if(v1_ind[i1] < v2_ind[i2]) {
+                r += v1_val[i1] * v1_val[i1];
+                i1++;
+            } else {
+                r += v2_val[i2] * v2_val[i2];
+                i2++;
+            }
+        }
+        while(i1 < n1)
+        {
+            r += v1_val[i1] * v1_val[i1];
+            i1++;
+        }
+        while(i2 < n2)
+        {
+            r += v2_val[i2] * v2_val[i2];
+            i2++;
         }
 
-        const double r = std::max(std::sqrt(x_norm_collector), aux_z.norm() * std::sqrt(n_comp));
+        return r;
+    }
+
+    // calculating eps_primal
+    double compute_eps_primal()
+    {
+        const double r = std::max(std::sqrt(sums[0]), aux_z.norm() * std::sqrt(double(n_comp)));
         return r * eps_rel + std::sqrt(double(dim_dual * n_comp)) * eps_abs;
     }
     // calculating eps_dual
-    virtual double compute_eps_dual()
+    double compute_eps_dual()
     {
-        double y_norm_collector = 0.0;
-        for(int i = 0; i < n_comp; i++)
-        {
-            y_norm_collector += worker[i]->squared_y_norm();
-        }
-
-        return std::sqrt(y_norm_collector) * eps_rel + std::sqrt(double(dim_main * n_comp)) * eps_abs;
+        return std::sqrt(sums[1]) * eps_rel + std::sqrt(double(dim_main * n_comp)) * eps_abs;
     }
     // calculating dual residual
-    virtual double compute_resid_dual(const VecTypeZ &new_z)
+    double compute_resid_dual(const SparseVector &new_z)
     {
-        VecTypeZ zdiff = new_z - aux_z;
-
-        return rho * std::sqrt(n_comp) * zdiff.norm();
+        return rho * std::sqrt(n_comp * diff_squared_norm(new_z, aux_z));
     }
-    // increase or decrease rho in iterations
-    virtual void update_rho()
+
+    // cold start of the workers with z = 0 and the current rho
+    void start()
     {
-        /* if(resid_primal > 10 * resid_dual)
-        {
-            rho *= 2;
-            rho_changed_action();
-        }
-        else if(resid_dual > 10 * resid_primal)
-        {
-            rho *= 0.5;
-            rho_changed_action();
-        } */
+        aux_z.setZero();
+        publish_z();
+        exchange(ConsensusTransport::CMD_INIT);
+
+        eps_primal = 0.0;
+        eps_dual = 0.0;
+        resid_primal = 9999;
+        resid_dual = 9999;
     }
 
 public:
@@ -165,53 +220,43 @@ public:
         dim_aux(p_),
         dim_dual(p_),
         n_comp(n_comp_),
-        worker(n_comp_),
+        transport(NULL),
         aux_z(dim_aux),
-        eps_abs(eps_abs_), eps_rel(eps_rel_)
+        sum_xu(Vector::Zero(dim_aux)),
+        eps_abs(eps_abs_), eps_rel(eps_rel_),
+        telemetry(NULL), deadline(NULL)
     {}
 
     virtual ~PADMMBase_Master() {}
 
-    void update_x()
+    void update_z()
     {
-        eps_primal = compute_eps_primal();
-        eps_dual = compute_eps_dual();
-        update_rho();
-
-        #ifdef _OPENMP
-        #pragma omp parallel for schedule(static)
-        #endif
-        for(int i = 0; i < n_comp; i++)
+        SparseVector newz(dim_aux);
         {
-            worker[i]->update_rho(rho);
-            worker[i]->update_x();
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::Z_UPDATE);
+            next_z(newz);
         }
-    }
-
-    void update_z()
-    {
-        VecTypeZ newz(dim_aux);
-        next_z(newz);
 
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
         resid_dual = compute_resid_dual(newz);
 
         aux_z.swap(newz);
     }
 
-    void update_y()
+    // the y update with the new z and the x update of the next iteration,
+    // timed together as the x update since the workers do both in one round
+    void update_y_x()
     {
-        double resid_primal_collector = 0.0;
-
-        #ifdef _OPENMP
-        #pragma omp parallel for schedule(static) reduction(+:resid_primal_collector)
-        #endif
-        for(int i = 0; i < n_comp; i++)
         {
-            worker[i]->update_y();
-            resid_primal_collector += worker[i]->squared_resid_primal();
+            SolverTelemetry::Timer timer(telemetry, SolverTelemetry::X_UPDATE);
+            publish_z();
+            exchange(ConsensusTransport::CMD_STEP);
         }
 
-        resid_primal = std::sqrt(resid_primal_collector);
+        SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
+        resid_primal = std::sqrt(sums[2]);
+        eps_primal = compute_eps_primal();
+        eps_dual = compute_eps_dual();
     }
 
     bool converged()
@@ -226,18 +271,34 @@ public:
 
         for(i = 0; i < maxit; i++)
         {
-            update_x();
             update_z();
-            update_y();
+            update_y_x();
+            if(telemetry)
+                telemetry->sample(i, resid_primal, resid_dual, rho);
 
             if(converged())
                 break;
+
+            if(deadline && deadline->expired())
+                break;
         }
 
+        if(telemetry && maxit > 0)
+            telemetry->finish(std::min(i, maxit - 1), resid_primal, resid_dual, rho);
+
         return i + 1;
     }
 
-    virtual VecTypeZ get_z() { return aux_z; }
+    // records the phases of the following fits in telemetry_
+    void set_telemetry(SolverTelemetry *telemetry_) { telemetry = telemetry_; }
+
+    // stops the following fits after the iteration in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+
+    double get_resid_primal() const { return resid_primal; }
+    double get_resid_dual() const { return resid_dual; }
+
+    virtual SparseVector get_z() { return aux_z; }
 };
 
 
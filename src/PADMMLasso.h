@@ -3,43 +3,54 @@
 
 #include "PADMMBase.h"
 #include "Linalg/BlasWrapper.h"
-
-class PADMMLasso_Worker: public PADMMBase_Worker< float, Eigen::VectorXf, Eigen::SparseVector<float> >
+#include "Spectra/SymEigsSolver.h"
+
+// minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
+//
+// by consensus ADMM over n_comp blocks of rows (A_i, b_i) of (X, y),
+// see PADMMBase.h. Scalar is the type of the data and the iterates
+// held by the workers (double or float), z, the master and the results
+// of the reductions are in double
+template<typename Scalar>
+class PADMMLasso_Worker: public PADMMBase_Worker<Scalar>
 {
 private:
-    typedef Eigen::SparseVector<float> SparseVector;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> Vector;
+    typedef PADMMBase_Worker<Scalar> Base;
+    typedef typename Base::MapVecd MapVecd;
     typedef Eigen::LLT<Matrix> LLT;
 
+    using Base::subA;
+    using Base::subb;
+    using Base::dim_main;
+    using Base::main_x;
+    using Base::dual_y;
+    using Base::rho;
+
     Vector Ab;
-    LLT solver;
+    LLT solver;              // factorization of A_i'A_i + rho * I, or of A_i * A_i' + rho * I for wide blocks
 
     // res = x in next iteration
-    void next_x(Vector &res)
+    void next_x(Vector &res, const MapVecd &z)
     {
         Vector rhs = Ab - dual_y;
-        for(SparseVector::InnerIterator iter(aux_z); iter; ++iter)
-            rhs[iter.index()] += rho * iter.value();
+        rhs.noalias() += (rho * z).template cast<Scalar>();
 
         if(subA.rows() >= subA.cols())
         {
             res.noalias() = solver.solve(rhs);
         } else {
             res.noalias() = rhs - subA.transpose() * solver.solve(subA * rhs);
-            res /= float(rho);
+            res /= Scalar(rho);
         }
 
     }
-    // res = primal residual in next iteration
-    void next_residual(Vector &res)
-    {
-        res = main_x;
-        res -= aux_z;
-    }
 
 public:
-    PADMMLasso_Worker< float, Eigen::VectorXf, Eigen::SparseVector<float> >
-    (ConstGenericMatrix &subA_, ConstGenericVector &subb_, SparseVector &aux_z_) :
-        PADMMBase_Worker(subA_, subb_, aux_z_),
+    template<typename MatA, typename VecB>
+    PADMMLasso_Worker(const Eigen::MatrixBase<MatA> &subA_, const Eigen::MatrixBase<VecB> &subb_) :
+        Base(subA_, subb_),
         Ab(subA.transpose() * subb)
     {}
 
@@ -57,159 +68,150 @@ public:
             Linalg::cross_prod_lower(AA, subA);
         else
             Linalg::tcross_prod_lower(AA, subA);
-        AA.diagonal().array() += rho;
-        solver.compute(AA.selfadjointView<Eigen::Lower>());
+        AA.diagonal().array() += Scalar(rho);
+        solver.compute(AA.template selfadjointView<Eigen::Lower>());
+    }
 
-        rho_changed_action();
+    // res = A_i' * A_i * v
+    void multiply(const double *v, double *res)
+    {
+        Vector Av = subA * MapVecd(v, dim_main).template cast<Scalar>();
+        Eigen::Map<Eigen::VectorXd>(res, dim_main) = (subA.transpose() * Av).template cast<double>();
     }
+};
 
-    void add_xu_to(Vector &res)
+
+// X'X = sum_i A_i'A_i as an operator for Spectra, never formed. each
+// product is one round of the workers
+class PADMMLasso_XtX
+{
+private:
+    ConsensusTransport &transport;
+    const int dim;
+    Eigen::VectorXd res;
+    double sums[3];
+
+public:
+    PADMMLasso_XtX(ConsensusTransport &transport_, int dim_) :
+        transport(transport_), dim(dim_)
+    {}
+
+    int rows() { return dim; }
+    int cols() { return dim; }
+
+    // y_out = X'X * x_in
+    void perform_op(double *x_in, double *y_out)
     {
-        res.noalias() += main_x + dual_y / rho;
+        std::copy(x_in, x_in + dim, transport.z());
+        transport.broadcast(ConsensusTransport::CMD_MULT, 0.0);
+        transport.reduce(res, sums);
+        std::copy(res.data(), res.data() + dim, y_out);
     }
 };
 
-class PADMMLasso_Master: public PADMMBase_Master< float, Eigen::VectorXf, Eigen::SparseVector<float> >
+
+template<typename Scalar>
+class PADMMLasso_Master: public PADMMBase_Master, public ConsensusFactory
 {
 private:
-    typedef Eigen::Map<const Matrix> MapMat;
-    typedef Eigen::Map<const Vector> MapVec;
-    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
-    typedef const Eigen::Ref<const Vector> ConstGenericVector;
-    typedef Eigen::SparseVector<float> SparseVector;
+    typedef PADMMLasso_Worker<Scalar> Worker;
 
     double lambda;         // L1 penalty parameter
     const double lambda0;  // with this lambda, all coefficients will be zero
+    Eigen::ArrayXd penalty_factor;  // penalty multiplication factors
+    double max_eig;        // largest eigenvalue of X'X, negative until needed
 
-    static void soft_threshold(SparseVector &res, const Vector &vec, const double &penalty)
-    {
-        int v_size = vec.size();
-        res.setZero();
-        res.reserve(v_size);
-
-        const float *ptr = vec.data();
-        for(int i = 0; i < v_size; i++)
-        {
-            if(ptr[i] > penalty)
-                res.insertBack(i) = ptr[i] - penalty;
-            else if(ptr[i] < -penalty)
-                res.insertBack(i) = ptr[i] + penalty;
-        }
-    }
+    Eigen::MatrixXd &datX;         // the data, until the workers hold their blocks
+    const Eigen::VectorXd &datY;
+    const int chunk_size;
 
     void next_z(SparseVector &res)
     {
-        Vector vec = Vector::Zero(dim_aux);
-        for(int i = 0; i < n_comp; i++)
+        const Vector vec = sum_xu / n_comp;
+
+        const double penalty = lambda / (rho * n_comp);
+        res.setZero();
+        res.reserve(dim_aux);
+        for(int i = 0; i < dim_aux; i++)
         {
-            static_cast<PADMMLasso_Worker *>(worker[i])->add_xu_to(vec);
+            const double pen = penalty * penalty_factor[i];
+            if(vec[i] > pen)
+                res.insertBack(i) = vec[i] - pen;
+            else if(vec[i] < -pen)
+                res.insertBack(i) = vec[i] + pen;
         }
-        vec /= n_comp;
-        soft_threshold(res, vec, lambda / (rho * n_comp));
     }
 
-    // Calculate ||v1 - v2||^2 when v1 and v2 are sparse
-    static double diff_squared_norm(const SparseVector &v1, const SparseVector &v2)
+public:
+    // worker i on the rows [i * chunk_size, (i + 1) * chunk_size) of the
+    // data, the last one also on the remaining rows
+    ConsensusEndpoint *make(int i)
     {
-        const int n1 = v1.nonZeros(), n2 = v2.nonZeros();
-        const float *v1_val = v1.valuePtr(), *v2_val = v2.valuePtr();
-        const int *v1_ind = v1.innerIndexPtr(), *v2_ind = v2.innerIndexPtr();
-
-        float r = 0.0;
-        int i1 = 0, i2 = 0;
-        while(i1 < n1 && i2 < n2)
-        {
-            if(v1_ind[i1] == v2_ind[i2])
-            {
-                float val = v1_val[i1] - v2_val[i2];
-                r += val * val;
-                i1++;
-                i2++;
-            } else if(v1_ind[i1] < v2_ind[i2]) {
-                r += v1_val[i1] * v1_val[i1];
-                i1++;
-            } else {
-                r += v2_val[i2] * v2_val[i2];
-                i2++;
-            }
-        }
-        while(i1 < n1)
-        {
-            r += v1_val[i1] * v1_val[i1];
-            i1++;
-        }
-        while(i2 < n2)
-        {
-            r += v2_val[i2] * v2_val[i2];
-            i2++;
-        }
-
-        return r;
+        const int size = (i < n_comp - 1) ? chunk_size : (datX.rows() - i * chunk_size);
+        return new Worker(datX.block(i * chunk_size, 0, size, dim_main),
+                          datY.segment(i * chunk_size, size));
     }
 
-    double compute_resid_dual(const SparseVector &new_z)
+    void release()
     {
-        return rho * std::sqrt(n_comp * diff_squared_norm(new_z, aux_z));
+        datX.resize(0, 0);
     }
 
-public:
-    PADMMLasso_Master(ConstGenericMatrix &datX_, ConstGenericVector &datY_,
-                      int nthread_,
+    // datX_ and datY_ are the standardized data, split into n_comp_
+    // blocks of consecutive rows, one per worker. the workers run on
+    // threads of this process, or in child processes if processes_ is
+    // true, and datX_ is released once they hold their blocks
+    PADMMLasso_Master(Eigen::MatrixXd &datX_, const Eigen::VectorXd &datY_,
+                      Eigen::ArrayXd &penalty_factor_,
+                      int n_comp_,
+                      bool processes_ = false,
                       double eps_abs_ = 1e-6,
                       double eps_rel_ = 1e-6) :
-        PADMMBase_Master< float, Eigen::VectorXf, Eigen::SparseVector<float> >
-           (datX_.cols(), nthread_, eps_abs_, eps_rel_),
-        lambda0((datX_.transpose() * datY_).cwiseAbs().maxCoeff())
+        PADMMBase_Master(datX_.cols(), n_comp_, eps_abs_, eps_rel_),
+        lambda0((datX_.transpose() * datY_).cwiseAbs().maxCoeff()),
+        penalty_factor(penalty_factor_),
+        max_eig(-1.0),
+        datX(datX_),
+        datY(datY_),
+        chunk_size(datX_.rows() / n_comp_)
     {
-        const int chunk_size = datX_.rows() / n_comp;
-        const int last_size = chunk_size + datX_.rows() % n_comp;
-
-#ifdef _OPENMP
-        #pragma omp parallel for schedule(static)
-#endif
-        for(int i = 0; i < n_comp; i++)
-        {
-            if(i < n_comp - 1)
-                worker[i] = new PADMMLasso_Worker(
-                    datX_.block(i * chunk_size, 0, chunk_size, dim_main),
-                    datY_.segment(i * chunk_size, chunk_size), aux_z);
-            else
-                worker[i] = new PADMMLasso_Worker(
-                    datX_.block(i * chunk_size, 0, last_size, dim_main),
-                    datY_.segment(i * chunk_size, last_size), aux_z);
-        }
+        if(processes_)
+            transport = new ConsensusProcesses(n_comp, dim_main, *this);
+        else
+            transport = new ConsensusThreads(n_comp, dim_main, *this);
     }
 
     ~PADMMLasso_Master()
     {
-        for(int i = 0; i < n_comp; i++)
-        {
-            delete worker[i];
-        }
+        delete transport;
     }
 
-    double get_lambda_zero() { return lambda0; }
+    double get_lambda_zero() const { return lambda0; }
 
     // init() is a cold start for the first lambda
     void init(double lambda_, double rho_)
     {
-        aux_z.setZero();
         lambda = lambda_;
         rho = rho_;
 
+        // the default rho of ADMMLassoTall, divided among the n_comp
+        // copies of beta: sum_i (A_i'A_i + rho * I) = X'X + n_comp * rho * I
         if(rho <= 0)
-            rho = lambda / n_comp;
-
-        for(int i = 0; i < n_comp; i++)
         {
-            static_cast<PADMMLasso_Worker *>(worker[i])->init(rho);
+            if(max_eig < 0)
+            {
+                PADMMLasso_XtX op(*transport, dim_main);
+                Spectra::SymEigsSolver< double, Spectra::LARGEST_ALGE, PADMMLasso_XtX > eigs(&op, 1, 3);
+                srand(0);
+                eigs.init();
+                eigs.compute(100, 0.1);
+                max_eig = eigs.eigenvalues()[0];
+            }
+            rho = std::pow(max_eig, 1.0 / 3) * std::pow(lambda, 2.0 / 3) / n_comp;
         }
-        eps_primal = 0.0;
-        eps_dual = 0.0;
-        resid_primal = 9999;
-        resid_dual = 9999;
 
-        rho_changed_action();
+        // the factorizations are computed by the workers
+        start();
     }
     // when computing for the next lambda, we can use the
     // current main_x, aux_z, dual_y and rho as initial values
@@ -0,0 +1,446 @@
+#ifndef PADMMLASSOWIDE_H
+#define PADMMLASSOWIDE_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <new>
+#include "ADMMLassoWide.h"
+#include "Penalty.h"
+#include "Telemetry.h"
+#include "Deadline.h"
+
+// Parallel ADMM by splitting variables (sharing ADMM)
+//   minimize  1/2 * ||y - X * beta||^2 + lambda * ||beta||_1
+//
+// with X = [X_1, ..., X_N] split into N blocks of columns and beta into
+// the blocks beta_k. With x_k = X_k * beta_k (n-vectors) this is
+//   minimize \sum g_k(beta_k) + f(\sum x_k)
+//
+// g_k(beta_k) => lambda * ||beta_k||_1
+// f(s)        => 1/2 * ||s - y||^2
+//
+// and the scaled sharing ADMM iterations are, with xbar = \sum x_k / N,
+//   beta_k <- argmin g_k(beta_k) + rho/2 * ||X_k * beta_k - x_k + xbar - zbar + u||^2
+//   zbar   <- (y + rho * (u + xbar)) / (N + rho)
+//   u      <- u + xbar - zbar
+//
+// The beta_k update is linearized as in ADMMLassoWide, one soft
+// thresholding step with the spectral radius of X_k'X_k, so all the
+// workers use the same n-vector v = xbar - zbar + u and the blocks only
+// interact through the sum of the x_k.
+//
+// Each worker owns a block of columns and its beta_k, and runs on its
+// own thread, started with the solver (so the hardware counters of the
+// fit, PerfCounters.h, include them) and running until it is deleted.
+// The sum of the x_k is a reduce-scatter without locks: after a
+// barrier, thread k adds up rows [start_k, end_k) of all the x_k and
+// updates zbar, u and v on those rows only
+class PADMMLassoWide_Worker
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::SparseVector<double> SparseVector;
+
+    Matrix subX;             // columns of this worker, copied by the thread that owns it
+    Vector pen_fact;         // penalty factors of the columns
+    double sprad;            // spectral radius of X_k'X_k
+
+public:
+    const int start;         // first column of the block in X
+    const int dim;           // number of columns
+    SparseVector beta;       // beta_k
+    Vector xk;               // X_k * beta_k
+
+    template<typename Derived>
+    PADMMLassoWide_Worker(const Eigen::MatrixBase<Derived> &subX_, const Eigen::ArrayXd &pen_fact_, int start_) :
+        subX(subX_),
+        pen_fact(pen_fact_.matrix()),
+        start(start_),
+        dim(subX.cols()),
+        beta(dim),
+        xk(Vector::Zero(subX.rows()))
+    {
+        sprad = ADMMLassoWide::spectral_radius(subX);
+    }
+
+    double get_sprad() const { return sprad; }
+
+    void init()
+    {
+        beta.setZero();
+        xk.setZero();
+    }
+
+    // one linearized update of beta_k from v = xbar - zbar + u, over all
+    // the columns (regular) or over the current nonzeros of beta_k only,
+    // as in ADMMLassoWide, then x_k = X_k * beta_k
+    void update(const Vector &v, double lambda, double rho, bool regular)
+    {
+        const double penalty = lambda / (rho * sprad);
+
+        if(regular)
+        {
+            Vector vec = beta;
+            vec.noalias() -= subX.transpose() * v / sprad;
+            penalty_prox<true>(beta, vec, penalty, PenaltyL1(), pen_fact);
+        } else {
+            double *val_ptr = beta.valuePtr();
+            const int *ind_ptr = beta.innerIndexPtr();
+            const int nnz = beta.nonZeros();
+            for(int i = 0; i < nnz; i++)
+            {
+                const double val = val_ptr[i] - subX.col(ind_ptr[i]).dot(v) / sprad;
+                val_ptr[i] = PenaltyL1::soft_threshold(val, pen_fact[ind_ptr[i]] * penalty);
+            }
+            beta.prune(0.0);
+        }
+
+        xk.noalias() = subX * beta;
+    }
+};
+
+
+class PADMMLassoWide_Master
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::SparseVector<double> SparseVector;
+
+    const int dim_main;      // number of variables
+    const int dim_dual;      // number of observations
+    const int n_comp;        // number of blocks of columns
+    std::vector<PADMMLassoWide_Worker *> worker;
+
+    const Vector datY;
+    Vector xbar;
+    Vector zbar;
+    Vector dual_u;           // scaled dual variable
+    Vector coupling;         // v = xbar - zbar + u
+    std::vector<int> row_start;  // rows [row_start[k], row_start[k + 1]) are reduced by thread k
+
+    double sprad;            // largest spectral radius of the blocks
+    double lambda;           // L1 penalty parameter
+    double lambda0;          // with this lambda, all coefficients will be zero
+    double rho;              // augmented Lagrangian parameter
+    const double eps_abs;    // absolute tolerance
+    const double eps_rel;    // relative tolerance
+
+    double eps_primal;       // tolerance for primal residual
+    double eps_dual;         // tolerance for dual residual
+    double resid_primal;     // primal residual
+    double resid_dual;       // dual residual
+    int iter_counter;        // iterations since init() or init_warm()
+    SolverTelemetry *telemetry;  // timings of the phases, NULL if not recorded
+    SolveDeadline *deadline;     // time budget and interruption, NULL if none
+
+    // the threads of workers 1, ..., N - 1, worker 0 runs on the thread
+    // of the master. the master starts round r of the iteration by
+    // setting round to r, and the threads count themselves in updated
+    // after their beta_k update and in reduced after their rows, so
+    // that r * N means all have finished round r. round -1 stops them
+    typedef std::atomic<long long> Counter;
+    std::vector<std::thread> threads;
+    Counter round;
+    Counter updated;
+    Counter reduced;
+    Counter built;           // workers constructed by their threads
+    std::atomic<int> failed; // a worker could not be constructed
+    bool round_regular;      // the kind of beta_k update of the round
+
+    // sums of squares over the rows of each thread, reduced by the master
+    struct RowSums
+    {
+        double xbar, zbar, u, r, dz;
+    };
+    std::vector<RowSums> sums;
+
+    // rows [begin, end) of xbar, zbar, u and v from the x_k
+    void reduce_rows(int k)
+    {
+        RowSums &s = sums[k];
+        s.xbar = s.zbar = s.u = s.r = s.dz = 0.0;
+
+        for(int i = row_start[k]; i < row_start[k + 1]; i++)
+        {
+            double xs = 0.0;
+            for(int j = 0; j < n_comp; j++)
+                xs += worker[j]->xk[i];
+            xs /= n_comp;
+
+            const double z = (datY[i] + rho * (dual_u[i] + xs)) / (n_comp + rho);
+            const double r = xs - z;
+            const double u = dual_u[i] + r;
+
+            s.xbar += xs * xs;
+            s.zbar += z * z;
+            s.u += u * u;
+            s.r += r * r;
+            s.dz += (z - zbar[i]) * (z - zbar[i]);
+
+            xbar[i] = xs;
+            zbar[i] = z;
+            dual_u[i] = u;
+            coupling[i] = xs - z + u;
+        }
+    }
+
+    // spins, then yields, until counter reaches target
+    static long long wait_for(const Counter &counter, long long target)
+    {
+        long long val;
+        for(int spins = 0; (val = counter.load(std::memory_order_acquire)) < target; spins++)
+        {
+            if(spins > 1000)
+                std::this_thread::yield();
+        }
+        return val;
+    }
+
+    // worker k's part of round r
+    void run_round(int k, long long r)
+    {
+        worker[k]->update(coupling, lambda, rho, round_regular);
+        updated.fetch_add(1, std::memory_order_acq_rel);
+        wait_for(updated, r * n_comp);
+
+        reduce_rows(k);
+        reduced.fetch_add(1, std::memory_order_release);
+    }
+
+    void make_worker(int k, const Eigen::MatrixXd &datX, const Eigen::ArrayXd &penalty_factor,
+                     int chunk_size, int last_size)
+    {
+        const int size = (k < n_comp - 1) ? chunk_size : last_size;
+        try {
+            worker[k] = new PADMMLassoWide_Worker(datX.middleCols(k * chunk_size, size),
+                                                  penalty_factor.segment(k * chunk_size, size),
+                                                  k * chunk_size);
+        } catch(...) {
+            worker[k] = NULL;
+            failed.store(1);
+        }
+    }
+
+    // the loop of the thread of worker k, which builds the worker
+    // where it runs (first touch) and then serves the rounds
+    void serve(int k, const Eigen::MatrixXd *datX, const Eigen::ArrayXd *penalty_factor,
+               int chunk_size, int last_size)
+    {
+        make_worker(k, *datX, *penalty_factor, chunk_size, last_size);
+        built.fetch_add(1, std::memory_order_release);
+
+        long long seen = 0;
+        for(;;)
+        {
+            long long r;
+            for(int spins = 0; (r = round.load(std::memory_order_acquire)) == seen; spins++)
+            {
+                if(spins > 1000)
+                    std::this_thread::yield();
+            }
+            if(r < 0)
+                break;
+            seen = r;
+            run_round(k, r);
+        }
+    }
+
+    void stop_threads()
+    {
+        round.store(-1, std::memory_order_release);
+        for(size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+        threads.clear();
+        for(int k = 0; k < n_comp; k++)
+            delete worker[k];
+    }
+
+    bool converged()
+    {
+        double xbar_sq = 0.0, zbar_sq = 0.0, u_sq = 0.0, r_sq = 0.0, dz_sq = 0.0;
+        for(int k = 0; k < n_comp; k++)
+        {
+            xbar_sq += sums[k].xbar;
+            zbar_sq += sums[k].zbar;
+            u_sq += sums[k].u;
+            r_sq += sums[k].r;
+            dz_sq += sums[k].dz;
+        }
+
+        // the residuals of the N copies x_k - z_k = xbar - zbar
+        const double sqrtN = std::sqrt(double(n_comp));
+        resid_primal = sqrtN * std::sqrt(r_sq);
+        resid_dual = rho * sqrtN * std::sqrt(sprad * dz_sq);
+        eps_primal = sqrtN * std::max(std::sqrt(xbar_sq), std::sqrt(zbar_sq)) * eps_rel +
+                     std::sqrt(double(dim_dual * n_comp)) * eps_abs;
+        eps_dual = rho * sqrtN * std::sqrt(sprad * u_sq) * eps_rel +
+                   std::sqrt(double(dim_main)) * eps_abs;
+
+        return (resid_primal < eps_primal) && (resid_dual < eps_dual);
+    }
+
+public:
+    // datX_ and datY_ are the standardized data, datX_ is split into
+    // n_comp_ blocks of consecutive columns, one per thread
+    PADMMLassoWide_Master(const Eigen::MatrixXd &datX_, const Eigen::VectorXd &datY_,
+                          const Eigen::ArrayXd &penalty_factor_,
+                          int n_comp_,
+                          double eps_abs_ = 1e-6,
+                          double eps_rel_ = 1e-6) :
+        dim_main(datX_.cols()),
+        dim_dual(datX_.rows()),
+        n_comp(n_comp_),
+        worker(n_comp_),
+        datY(datY_),
+        xbar(dim_dual), zbar(dim_dual), dual_u(dim_dual), coupling(dim_dual),
+        row_start(n_comp_ + 1),
+        lambda0((datX_.transpose() * datY_).cwiseAbs().maxCoeff()),
+        eps_abs(eps_abs_), eps_rel(eps_rel_),
+        telemetry(NULL), deadline(NULL),
+        round(0), updated(0), reduced(0), built(0), failed(0),
+        round_regular(true),
+        sums(n_comp_)
+    {
+        const int chunk_size = dim_main / n_comp;
+        const int last_size = chunk_size + dim_main % n_comp;
+
+        for(int k = 1; k < n_comp; k++)
+            threads.push_back(std::thread(&PADMMLassoWide_Master::serve, this, k,
+                                          &datX_, &penalty_factor_, chunk_size, last_size));
+        make_worker(0, datX_, penalty_factor_, chunk_size, last_size);
+        // datX_ may be released once all the blocks are copied
+        wait_for(built, n_comp - 1);
+        if(failed.load())
+        {
+            stop_threads();
+            throw std::bad_alloc();
+        }
+
+        sprad = 0.0;
+        for(int k = 0; k < n_comp; k++)
+            sprad = std::max(sprad, worker[k]->get_sprad());
+
+        for(int k = 0; k <= n_comp; k++)
+            row_start[k] = int((long long)(dim_dual) * k / n_comp);
+    }
+
+    ~PADMMLassoWide_Master()
+    {
+        stop_threads();
+    }
+
+    double get_lambda_zero() const { return lambda0; }
+
+    // init() is a cold start for the first lambda
+    void init(double lambda_, double rho_)
+    {
+        for(int k = 0; k < n_comp; k++)
+            worker[k]->init();
+        xbar.setZero();
+        zbar.setZero();
+        dual_u.setZero();
+        coupling.setZero();
+
+        lambda = lambda_;
+        rho = rho_;
+
+        // the default of ADMMLassoWide with the spectral radius of the blocks
+        if(rho <= 0)
+            rho = std::pow(lambda / sprad, 1.0 / 3);
+
+        init_warm(lambda_, 0);
+    }
+    // when computing for the next lambda, we can use the
+    // current beta, zbar, u and rho as initial values
+    void init_warm(double lambda_, int iternum)
+    {
+        lambda = lambda_;
+
+        eps_primal = 0.0;
+        eps_dual = 0.0;
+        resid_primal = 9999;
+        resid_dual = 9999;
+
+        iter_counter = 0;
+    }
+
+    int solve(int maxit)
+    {
+        if(lambda > lambda0 - 1e-5)
+        {
+            for(int k = 0; k < n_comp; k++)
+                worker[k]->init();
+            return 1;
+        }
+
+        // the updates between two regular ones cannot add variables, so
+        // convergence is only accepted after a regular update
+        bool check_full = false;
+
+        int i;
+        for(i = 0; i < maxit; i++)
+        {
+            const bool regular = check_full || ADMMLassoWide::is_regular_update(iter_counter);
+
+            // the z and u updates are the row reductions in the same
+            // round, and are timed with the beta updates
+            {
+                SolverTelemetry::Timer timer(telemetry, SolverTelemetry::X_UPDATE);
+                const long long r = round.load(std::memory_order_relaxed) + 1;
+                round_regular = regular;
+                round.store(r, std::memory_order_release);
+                run_round(0, r);
+                wait_for(reduced, r * n_comp);
+            }
+
+            iter_counter++;
+            {
+                SolverTelemetry::Timer timer(telemetry, SolverTelemetry::CONVERGENCE);
+                check_full = converged();
+            }
+            if(telemetry)
+                telemetry->sample(i, resid_primal, resid_dual, rho);
+            if(check_full && regular)
+                break;
+
+            if(deadline && deadline->expired())
+                break;
+        }
+
+        if(telemetry && maxit > 0)
+            telemetry->finish(std::min(i, maxit - 1), resid_primal, resid_dual, rho);
+
+        return i + 1;
+    }
+
+    // records the phases of the following fits in telemetry_
+    void set_telemetry(SolverTelemetry *telemetry_) { telemetry = telemetry_; }
+
+    // stops the following fits after the iteration in which deadline_ expires
+    void set_deadline(SolveDeadline *deadline_) { deadline = deadline_; }
+
+    double get_resid_primal() const { return resid_primal; }
+    double get_resid_dual() const { return resid_dual; }
+
+    SparseVector get_beta()
+    {
+        SparseVector res(dim_main);
+        int nnz = 0;
+        for(int k = 0; k < n_comp; k++)
+            nnz += worker[k]->beta.nonZeros();
+        res.reserve(nnz);
+
+        for(int k = 0; k < n_comp; k++)
+        {
+            for(SparseVector::InnerIterator iter(worker[k]->beta); iter; ++iter)
+                res.insertBack(worker[k]->start + iter.index()) = iter.value();
+        }
+        return res;
+    }
+};
+
+#endif // PADMMLASSOWIDE_H
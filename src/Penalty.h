@@ -0,0 +1,183 @@
+#ifndef PENALTY_H
+#define PENALTY_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+
+// Penalty policies shared by the coordinate descent solvers and the
+// proximal (z-update) step of the ADMM solvers. Each policy provides
+//
+//   threshold(z, pen): the minimizer of 1/2 * (b - z)^2 + pen * P(b),
+//                      where pen = lambda / curvature (||x_j||^2 in
+//                      coordinate descent, rho in ADMM)
+//   value(b, lambda):  the penalty lambda * P(b) itself
+//
+// The policies are used as template parameters, so the thresholding is
+// inlined into the inner loops. Penalty factors (weighted penalties) are
+// a separate compile-time flag, see penalty_prox() below.
+//
+// For MCP and SCAD the thresholding rules are the ones for standardized
+// columns, as in ncvreg. A coordinate whose curvature is v times that of
+// a standardized column (e.g. x_j'W x_j / n in IRLS) is thresholded with
+// scaled(v), the policy with gamma * v.
+
+struct PenaltyL1
+{
+    static double soft_threshold(double z, double pen)
+    {
+        if(z > pen)
+            return(z - pen);
+        else if(z < -pen)
+            return(z + pen);
+        else
+            return(0);
+    }
+    
+    double threshold(double z, double pen) const
+    {
+        return soft_threshold(z, pen);
+    }
+    
+    PenaltyL1 scaled(double v) const { return *this; }
+    
+    double value(double b, double lambda) const
+    {
+        return lambda * std::abs(b);
+    }
+};
+
+// alpha * |b| + (1 - alpha) / 2 * b^2
+struct PenaltyEnet
+{
+    double alpha;
+    
+    PenaltyEnet(double alpha_ = 1.0) : alpha(alpha_) {}
+    
+    double threshold(double z, double pen) const
+    {
+        return PenaltyL1::soft_threshold(z, alpha * pen) / (1.0 + pen * (1.0 - alpha));
+    }
+    
+    PenaltyEnet scaled(double v) const { return *this; }
+    
+    double value(double b, double lambda) const
+    {
+        return lambda * (alpha * std::abs(b) + 0.5 * (1.0 - alpha) * b * b);
+    }
+};
+
+struct PenaltyMCP
+{
+    double gamma;
+    
+    PenaltyMCP(double gamma_ = 3.0) : gamma(gamma_) {}
+    
+    double threshold(double z, double pen) const
+    {
+        if (std::abs(z) > pen * gamma)
+        {
+            return(z);
+        } else if (z > pen)
+        {
+            return((z - pen) / (1 - 1/gamma));
+        } else if (z < -pen)
+        {
+            return((z + pen) / (1 - 1/gamma));
+        } else
+        {
+            return(0);
+        }
+    }
+    
+    // for gamma * v <= 1 the one-dimensional problem is not convex,
+    // and gamma = 1 gives hard thresholding at pen
+    PenaltyMCP scaled(double v) const
+    {
+        return PenaltyMCP(std::max(gamma * v, 1.0));
+    }
+    
+    double value(double b, double lambda) const
+    {
+        double abs_beta = std::abs(b);
+        if (abs_beta < lambda * gamma)
+            return lambda * (abs_beta - 0.5 * b * b / (lambda * gamma));
+        return 0.5 * lambda * lambda * gamma;
+    }
+};
+
+struct PenaltySCAD
+{
+    double gamma;
+    
+    PenaltySCAD(double gamma_ = 3.7) : gamma(gamma_) {}
+    
+    double threshold(double z, double pen) const
+    {
+        double absz = std::abs(z);
+        if (absz <= 2 * pen)
+            return PenaltyL1::soft_threshold(z, pen);
+        else if (absz <= gamma * pen)
+            return PenaltyL1::soft_threshold(z, gamma * pen / (gamma - 1)) / (1 - 1 / (gamma - 1));
+        else
+            return(z);
+    }
+    
+    // likewise SCAD needs gamma * v > 2
+    PenaltySCAD scaled(double v) const
+    {
+        return PenaltySCAD(std::max(gamma * v, 2.0));
+    }
+    
+    double value(double b, double lambda) const
+    {
+        double abs_beta = std::abs(b);
+        if (abs_beta <= lambda)
+            return lambda * abs_beta;
+        else if (abs_beta <= gamma * lambda)
+            return (2 * gamma * lambda * abs_beta - b * b - lambda * lambda) / (2 * (gamma - 1));
+        return 0.5 * lambda * lambda * (gamma + 1);
+    }
+};
+
+// the policy for a value of the second parameter gamma, which the
+// lasso ignores. used by the solvers that fit a grid of gamma values
+template<typename Penalty>
+inline Penalty make_penalty(double gamma)
+{
+    return Penalty(gamma);
+}
+
+template<>
+inline PenaltyL1 make_penalty<PenaltyL1>(double gamma)
+{
+    return PenaltyL1();
+}
+
+// res = prox of the penalty applied elementwise to vec, stored sparsely.
+// with Weighted = true element i uses penalty pen_fact[i] * penalty
+template<bool Weighted, typename Penalty, typename FactorVec>
+inline void penalty_prox(Eigen::SparseVector<double> &res, const Eigen::VectorXd &vec,
+                         double penalty, const Penalty &pen, const FactorVec &pen_fact)
+{
+    int v_size = vec.size();
+    res.setZero();
+    res.reserve(v_size);
+    
+    const double *ptr = vec.data();
+    for(int i = 0; i < v_size; i++)
+    {
+        double val = pen.threshold(ptr[i], Weighted ? pen_fact[i] * penalty : penalty);
+        if(val != 0)
+            res.insertBack(i) = val;
+    }
+}
+
+template<typename Penalty>
+inline void penalty_prox(Eigen::SparseVector<double> &res, const Eigen::VectorXd &vec,
+                         double penalty, const Penalty &pen)
+{
+    penalty_prox<false>(res, vec, penalty, pen, vec);
+}
+
+
+#endif // PENALTY_H
@@ -0,0 +1,118 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+// hardware counters of perf_event_open(2) on Linux: cycles, instructions
+// and last level cache misses in user space, of the calling thread and of
+// the threads and processes it starts once the counters are open
+// (inherit). the workers of the parallel solvers (ConsensusTransport.h,
+// PADMMLassoWide.h) are started by each fit so they are counted, but
+// threads that already exist, such as the OpenMP pool left by an
+// earlier call, are not. the memory controller counters need
+// privileges, so the memory traffic is estimated as one cache line per
+// LLC miss. on other systems, or when the kernel refuses the events (see
+// /proc/sys/kernel/perf_event_paranoid), the counters are unavailable
+// and read as zeros
+class PerfCounters
+{
+public:
+    enum Event { CYCLES = 0, INSTRUCTIONS, LLC_MISSES, N_EVENTS };
+    static const int cache_line = 64;  // bytes moved per LLC miss
+
+private:
+    int fd[N_EVENTS];
+    bool ok;
+
+    PerfCounters(const PerfCounters &);
+    PerfCounters &operator=(const PerfCounters &);
+
+#ifdef __linux__
+    static int open_event(unsigned long long config)
+    {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // when there are fewer counters than events, the kernel
+        // multiplexes them and the counts are scaled by read()
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+
+    void close_all()
+    {
+#ifdef __linux__
+        for(int k = 0; k < N_EVENTS; k++)
+        {
+            if(fd[k] >= 0)
+                close(fd[k]);
+            fd[k] = -1;
+        }
+#endif
+        ok = false;
+    }
+
+public:
+    // nothing is opened unless enabled
+    explicit PerfCounters(bool enabled = true) : ok(false)
+    {
+        for(int k = 0; k < N_EVENTS; k++)
+            fd[k] = -1;
+#ifdef __linux__
+        if(!enabled)
+            return;
+
+        const unsigned long long config[N_EVENTS] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+        };
+        ok = true;
+        for(int k = 0; k < N_EVENTS && ok; k++)
+        {
+            fd[k] = open_event(config[k]);
+            ok = (fd[k] >= 0);
+        }
+        if(!ok)
+            close_all();
+#endif
+    }
+
+    ~PerfCounters() { close_all(); }
+
+    bool available() const { return ok; }
+
+    // values[k] = count of event k since the counters were opened
+    void read(double *values) const
+    {
+        for(int k = 0; k < N_EVENTS; k++)
+            values[k] = 0.0;
+#ifdef __linux__
+        if(!ok)
+            return;
+
+        for(int k = 0; k < N_EVENTS; k++)
+        {
+            // value, time enabled, time running
+            unsigned long long buf[3];
+            if(::read(fd[k], buf, sizeof(buf)) != ssize_t(sizeof(buf)) || buf[2] == 0)
+                continue;
+            values[k] = double(buf[0]) * (double(buf[1]) / double(buf[2]));
+        }
+#endif
+    }
+};
+
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,123 @@
+#ifndef PREPAREDDESIGN_H
+#define PREPAREDDESIGN_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <list>
+#include "DataStd.h"
+#include "CVFold.h"
+#include "ADMMMatOp.h"
+#include "Spectra/SymEigsSolver.h"
+#include "utils.h"
+
+// a design matrix prepared once for repeated gaussian fits with new
+// responses, lambdas or penalty factors (an external pointer on the R
+// side, see prepare_design()). it owns the standardized copy of X and
+// the quantities the solvers derive from X alone, each computed the
+// first time a fit needs it and reused by all later fits: the columns
+// of X'X (coordinate descent), the lower triangle of X'X, the largest
+// eigenvalue and the factorizations of X'X + rho * I (ADMM)
+class PreparedDesign
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::LDLT<Matrix> LDLT;
+    typedef std::pair<double, LDLT> Factorization;
+    
+    // at most this many factorizations are kept, the oldest is dropped
+    // first. a path uses one rho unless update_rho() changes it
+    static const int max_factorizations = 4;
+    
+    Matrix XX;                    // lower triangle of X'X, empty until needed
+    double max_eig;               // largest eigenvalue of X'X, negative until needed
+    std::list<Factorization> factorizations;
+    
+    // X is referenced by gram
+    PreparedDesign(const PreparedDesign&);
+    PreparedDesign &operator=(const PreparedDesign&);
+
+public:
+    const int n;
+    const int p;
+    const bool standardize;
+    const bool intercept;
+    
+    Matrix X;                     // standardized X
+    DataStd<double> datstd;       // standardization of X, the response part is unset
+    Vector Xsq;                   // colSums(X^2) of the standardized X
+    FullGram gram;                // columns of X'X, computed lazily
+    
+    PreparedDesign(const double *x, int n_, int p_, bool standardize_, bool intercept_) :
+        max_eig(-1.0),
+        n(n_), p(p_),
+        standardize(standardize_), intercept(intercept_),
+        X(Eigen::Map<const Matrix>(x, n_, p_)),
+        datstd(n_, p_, standardize_, intercept_),
+        gram(X)
+    {
+        datstd.standardize_x(X);
+        Xsq = X.array().square().colwise().sum().transpose();
+    }
+    
+    // the standardization of a response y for this design. Y is set
+    // to the standardized y, exactly as DataStd::standardize() would
+    DataStd<double> standardize_response(const double *y, Vector &Y) const
+    {
+        Y = Eigen::Map<const Vector>(y, n);
+        DataStd<double> res(datstd);
+        res.standardize_y(Y);
+        return res;
+    }
+    
+    const Matrix &gram_lower()
+    {
+        if (XX.size() == 0)
+            XX = XtX(X);
+        return XX;
+    }
+    
+    // largest eigenvalue of X'X, which is also that of XX'. it is
+    // computed from X'X in the tall case (n > 2p) and from XX' in the
+    // wide case, as ADMMLassoTall and ADMMLassoWide do
+    double max_eigenvalue()
+    {
+        if (max_eig < 0)
+            max_eig = (n > 2 * p) ? largest_eigenvalue(gram_lower()) : largest_eigenvalue(XXt(X));
+        return max_eig;
+    }
+    
+    // for a symmetric matrix given by its lower triangle
+    static double largest_eigenvalue(const Matrix &A)
+    {
+        MatOpSymLower<double> op(A);
+        Spectra::SymEigsSolver< double, Spectra::LARGEST_ALGE, MatOpSymLower<double> > eigs(&op, 1, 3);
+        srand(0);
+        eigs.init();
+        eigs.compute(100, 0.1);
+        return eigs.eigenvalues()[0];
+    }
+    
+    // factorization of X'X + rho * I
+    const LDLT &factorization(double rho)
+    {
+        for (std::list<Factorization>::iterator it = factorizations.begin(); it != factorizations.end(); ++it)
+        {
+            if (it->first == rho)
+                return it->second;
+        }
+        
+        if (int(factorizations.size()) >= max_factorizations)
+            factorizations.pop_front();
+        
+        Matrix matToSolve(gram_lower());
+        matToSolve.diagonal().array() += rho;
+        factorizations.push_back(Factorization(rho, LDLT()));
+        factorizations.back().second.compute(matToSolve.selfadjointView<Eigen::Lower>());
+        return factorizations.back().second;
+    }
+};
+
+
+
+#endif // PREPAREDDESIGN_H
@@ -0,0 +1,146 @@
+#ifndef RCPPBINDING_H
+#define RCPPBINDING_H
+
+#include <RcppEigen.h>
+#include "Console.h"
+#include "Telemetry.h"
+#include "Deadline.h"
+
+// the R side of the solvers, included by the entry points only: the
+// solver headers depend on Eigen alone, and their output and results
+// are converted to R here
+
+// true if the user has asked R to interrupt, e.g. by Ctrl-C. the
+// request is taken here, so the path stops cleanly instead of unwinding
+inline bool r_interrupt_pending()
+{
+    try {
+        Rcpp::checkUserInterrupt();
+    } catch (Rcpp::internal::InterruptedException &) {
+        return true;
+    }
+    return false;
+}
+
+namespace {
+// the debugging output of the solvers goes to the R console, and they
+// stop for the interrupts of R
+struct RSession
+{
+    RSession()
+    {
+        set_console(Rcpp::Rcout);
+        set_interrupt_check(r_interrupt_pending);
+    }
+};
+const RSession r_session;
+}
+
+// an nlambda x N_PHASES matrix with the phases as column names
+inline Rcpp::NumericMatrix phase_matrix(const Eigen::MatrixXd &mat)
+{
+    Rcpp::NumericMatrix res(mat.rows(), mat.cols(), mat.data());
+    Rcpp::colnames(res) = Rcpp::CharacterVector::create("setup", "factorize", "x_update",
+                                                        "z_update", "y_update", "convergence");
+    return res;
+}
+
+// cycles, instructions, LLC misses and the estimated memory traffic
+// and bandwidth (bytes per second) of the phases of the first nfit lambdas
+inline Rcpp::List counters_list(const SolverTelemetry &telemetry, int nfit)
+{
+    if (!telemetry.get_counters()->available())
+        return Rcpp::List::create(Rcpp::Named("available") = false);
+
+    const Eigen::MatrixXd misses = telemetry.event_matrix(PerfCounters::LLC_MISSES).topRows(nfit);
+    const Eigen::MatrixXd bytes = misses * double(PerfCounters::cache_line);
+    const Eigen::MatrixXd bandwidth = (bytes.array() / telemetry.get_times().topRows(nfit).max(1e-12)).matrix();
+
+    return Rcpp::List::create(Rcpp::Named("available") = true,
+                              Rcpp::Named("cycles") = phase_matrix(telemetry.event_matrix(PerfCounters::CYCLES).topRows(nfit)),
+                              Rcpp::Named("instructions") = phase_matrix(telemetry.event_matrix(PerfCounters::INSTRUCTIONS).topRows(nfit)),
+                              Rcpp::Named("llc_misses") = phase_matrix(misses),
+                              Rcpp::Named("memory_bytes") = phase_matrix(bytes),
+                              Rcpp::Named("memory_bandwidth") = phase_matrix(bandwidth));
+}
+
+// the telemetry of the first nfit lambdas of a path, those returned
+// with it when a deadline stopped it, and otherwise all of them
+inline Rcpp::List telemetry_list(const SolverTelemetry &telemetry, int nfit)
+{
+    Eigen::ArrayXi lambda, iter;
+    Eigen::ArrayXXd val;
+    telemetry.get_trace(lambda, iter, val);
+
+    // the samples are in the order of the lambdas
+    int nsamples = 0;
+    while (nsamples < lambda.size() && lambda[nsamples] < nfit)
+        nsamples++;
+
+    // lambdas and iterations from 1
+    Eigen::ArrayXi trace_lambda = lambda.head(nsamples) + 1;
+    Eigen::ArrayXi trace_iter = iter.head(nsamples) + 1;
+    Eigen::VectorXd rp = val.col(0).head(nsamples).matrix(),
+                    rd = val.col(1).head(nsamples).matrix(),
+                    rho = val.col(2).head(nsamples).matrix();
+
+    Rcpp::List res = Rcpp::List::create(Rcpp::Named("setup") = telemetry.get_setup(),
+                                        Rcpp::Named("time") = phase_matrix(telemetry.get_times().topRows(nfit).matrix()),
+                                        Rcpp::Named("rho_changes") = Rcpp::wrap(Eigen::ArrayXi(telemetry.get_rho_changes().head(nfit))),
+                                        Rcpp::Named("refactorizations") = Rcpp::wrap(Eigen::ArrayXi(telemetry.get_refactors().head(nfit))),
+                                        Rcpp::Named("trace") = Rcpp::List::create(
+                                            Rcpp::Named("lambda") = Rcpp::wrap(trace_lambda),
+                                            Rcpp::Named("iter") = Rcpp::wrap(trace_iter),
+                                            Rcpp::Named("resid_primal") = Rcpp::wrap(rp),
+                                            Rcpp::Named("resid_dual") = Rcpp::wrap(rd),
+                                            Rcpp::Named("rho") = Rcpp::wrap(rho)));
+    if (telemetry.get_counters())
+        res.push_back(counters_list(telemetry, nfit), "counters");
+    return res;
+}
+
+// the lambda at which a deadline stopped a path: why it stopped, the
+// lambda, its iterations, its last residuals (NA for the solvers
+// without) and the coefficients so far, intercept first
+inline Rcpp::List partial_fit(const SolveDeadline &deadline, double lambda, int niter,
+                              double resid_primal, double resid_dual, const Eigen::VectorXd &beta)
+{
+    const char *reason = (deadline.get_reason() == SolveDeadline::TIME_LIMIT) ? "time.limit" : "interrupt";
+    return Rcpp::List::create(Rcpp::Named("reason") = reason,
+                              Rcpp::Named("lambda") = lambda,
+                              Rcpp::Named("niter") = niter,
+                              Rcpp::Named("resid_primal") = resid_primal,
+                              Rcpp::Named("resid_dual") = resid_dual,
+                              Rcpp::Named("beta") = Rcpp::wrap(beta),
+                              Rcpp::Named("elapsed") = deadline.get_elapsed());
+}
+
+// the result of a path of fits, with the telemetry of the solver when
+// it was recorded (NULL otherwise). a path stopped by its deadline keeps
+// the nfit lambdas completed before, and the fit of the lambda it
+// stopped at in partial. BetaMatrix is dense or sparse
+template<typename BetaMatrix>
+inline Rcpp::List path_result(const Eigen::ArrayXd &lambda, const BetaMatrix &beta,
+                              const Rcpp::IntegerVector &niter, const SolverTelemetry *telemetry,
+                              int nfit, const Rcpp::List &partial)
+{
+    Rcpp::List res;
+    if (nfit < lambda.size())
+        res = Rcpp::List::create(Rcpp::Named("lambda") = Eigen::ArrayXd(lambda.head(nfit)),
+                                 Rcpp::Named("beta") = BetaMatrix(beta.leftCols(nfit)),
+                                 Rcpp::Named("niter") = Rcpp::IntegerVector(niter.begin(), niter.begin() + nfit),
+                                 Rcpp::Named("stopped") = true,
+                                 Rcpp::Named("partial") = partial);
+    else
+        res = Rcpp::List::create(Rcpp::Named("lambda") = lambda,
+                                 Rcpp::Named("beta") = beta,
+                                 Rcpp::Named("niter") = niter,
+                                 Rcpp::Named("stopped") = false,
+                                 Rcpp::Named("partial") = R_NilValue);
+    if (telemetry)
+        res.push_back(telemetry_list(*telemetry, nfit), "telemetry");
+    return res;
+}
+
+
+#endif // RCPPBINDING_H
@@ -0,0 +1,311 @@
+#ifndef STREAMGRAM_H
+#define STREAMGRAM_H
+
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "DataStd.h"
+#include "Linalg/BlasWrapper.h"
+#include "Linalg/Gram.h"
+
+// a read-only binary file of doubles (native byte order, as written by
+// R's writeBin()) mapped into memory. pages are read on demand by the
+// kernel, so the file may be much larger than the memory
+class MappedFile
+{
+private:
+    void *addr;
+    size_t len;
+
+    MappedFile(const MappedFile&);
+    MappedFile &operator=(const MappedFile&);
+
+public:
+    // the file must hold at least count doubles
+    MappedFile(const std::string &path, size_t count) :
+        addr(NULL), len(count * sizeof(double))
+    {
+#ifdef _WIN32
+        throw std::runtime_error("memory mapped files are not supported on Windows");
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < len)
+        {
+            close(fd);
+            throw std::runtime_error(path + " is smaller than the given dimensions");
+        }
+
+        if (len > 0)
+        {
+            addr = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                addr = NULL;
+                close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            madvise(addr, len, MADV_SEQUENTIAL);
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (addr != NULL)
+            munmap(addr, len);
+#endif
+    }
+
+    const double *data() const { return static_cast<const double*>(addr); }
+
+    // the doubles first, ..., first + count - 1 will not be read again,
+    // so their pages can be dropped instead of filling the memory
+    void release(size_t first, size_t count) const
+    {
+#ifndef _WIN32
+        const size_t page = sysconf(_SC_PAGESIZE);
+        size_t begin = first * sizeof(double);
+        size_t end = (first + count) * sizeof(double);
+        begin = (begin + page - 1) / page * page;
+        end = end / page * page;
+        if (end > begin)
+            madvise(static_cast<char*>(addr) + begin, end - begin, MADV_DONTNEED);
+#endif
+    }
+};
+
+
+// the standardized X'X (lower triangle) and X'y of a least squares
+// problem, accumulated over blocks of rows of an n x p matrix, e.g.
+// read from a MappedFile in column-major or row-major order, appended
+// as new observations arrive, or in one pass over a matrix in memory.
+// the results are those of standardizing X and y with
+// DataStd::standardize() and forming the products, without holding
+// more than one block of rows. the rows are shifted by the column
+// means of the first block before they are accumulated, so that
+// centring the sums (for the intercept and the scales) does not
+// subtract large, nearly equal numbers
+class StreamGram
+{
+private:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> Matrix;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Array<double, Eigen::Dynamic, 1> Array;
+    typedef Eigen::Map<const Vector> MapVec;
+    typedef const Eigen::Ref<const Matrix> ConstGenericMatrix;
+
+    const bool standardize;
+    const bool intercept;
+
+    Array shift_x;                // shifts of the columns of X and of y
+    double shift_y;
+    Matrix S;                     // (X - shift)'(X - shift), lower triangle
+    Vector t;                     // (X - shift)'(y - shift)
+    Array sx;                     // colSums(X - shift)
+    double sy;                    // sum(y - shift) and sum((y - shift)^2)
+    double syy;
+
+    // adds a block of rows, given as the rows of a k x p matrix or
+    // (transposed) the columns of a p x k matrix, which is overwritten
+    template<bool Transposed>
+    void add_block(Matrix &block, const double *y)
+    {
+        const int k = Transposed ? block.cols() : block.rows();
+        if (n == 0)
+        {
+            if (Transposed)
+                shift_x = block.rowwise().mean().array();
+            else
+                shift_x = block.colwise().mean().transpose().array();
+            shift_y = MapVec(y, k).mean();
+        }
+        Vector yb = MapVec(y, k).array() - shift_y;
+
+        if (Transposed)
+        {
+            block.colwise() -= shift_x.matrix();
+            Linalg::tcross_prod_lower(S, block, 1.0, 1.0);
+            t.noalias() += block * yb;
+            sx += block.rowwise().sum().array();
+        } else {
+            block.rowwise() -= shift_x.matrix().transpose();
+            Linalg::cross_prod_lower(S, block, 1.0, 1.0);
+            t.noalias() += block.transpose() * yb;
+            sx += block.colwise().sum().transpose().array();
+        }
+        sy += yb.sum();
+        syy += yb.squaredNorm();
+        n += k;
+    }
+
+public:
+    const int p;
+    int n;                        // number of rows so far
+
+    StreamGram(int p_, bool standardize_, bool intercept_) :
+        standardize(standardize_), intercept(intercept_),
+        shift_x(Array::Zero(p_)), shift_y(0.0),
+        S(Matrix::Zero(p_, p_)), t(Vector::Zero(p_)),
+        sx(Array::Zero(p_)), sy(0.0), syy(0.0),
+        p(p_), n(0)
+    {}
+
+    // adds the rows of a k x p matrix and their responses
+    void add_rows(ConstGenericMatrix &rows, const double *y)
+    {
+        Matrix block(rows);
+        add_block<false>(block, y);
+    }
+
+    // adds all the rows of X and their responses in one pass, as
+    // add_rows() would, with nthreads threads. each block of rows is
+    // shifted by columns, then its products are added to S by tiles of
+    // the lower triangle as in Linalg::gram_lower(), each tile owned by
+    // one thread, so no copy of S is needed
+    void add_matrix(ConstGenericMatrix &X, const double *y, int nthreads)
+    {
+        const int m = X.rows();
+        if (m == 0)
+            return;
+
+        // about 64MB of rows per block, and enough rows for dgemm
+        const int block_rows = std::max(256, 8388608 / std::max(p, 1));
+        if (n == 0)
+        {
+            const int k = std::min(m, block_rows);
+            shift_x = X.topRows(k).colwise().mean().transpose().array();
+            shift_y = MapVec(y, k).mean();
+        }
+
+        std::vector<int> first;
+        std::vector< std::pair<int, int> > tiles;
+        Linalg::gram_blocks(p, 256, first, tiles);
+        const int ntiles = tiles.size();
+
+        Matrix block;
+        Vector yb;
+        for (int r0 = 0; r0 < m; r0 += block_rows)
+        {
+            const int k = std::min(block_rows, m - r0);
+            block.resize(k, p);
+            yb = MapVec(y + r0, k).array() - shift_y;
+
+            #ifdef _OPENMP
+            #pragma omp parallel num_threads(nthreads)
+            #endif
+            {
+                #ifdef _OPENMP
+                #pragma omp for schedule(static)
+                #endif
+                for (int j = 0; j < p; j++)
+                {
+                    block.col(j) = X.col(j).segment(r0, k).array() - shift_x[j];
+                    t[j] += block.col(j).dot(yb);
+                    sx[j] += block.col(j).sum();
+                }
+
+                #ifdef _OPENMP
+                #pragma omp for schedule(dynamic)
+                #endif
+                for (int l = 0; l < ntiles; l++)
+                {
+                    const int I = tiles[l].first, J = tiles[l].second;
+                    const int i0 = first[I], j0 = first[J];
+                    Linalg::gram_block(&S(i0, j0), p, block, i0, first[I + 1] - i0,
+                                       j0, first[J + 1] - j0, 1.0);
+                }
+            }
+            sy += yb.sum();
+            syy += yb.squaredNorm();
+        }
+        n += m;
+    }
+
+    // adds all n_ rows of x, in blocks of block_rows rows
+    void accumulate(const MappedFile &x, int n_, bool row_major, const double *y, int block_rows)
+    {
+        Matrix block;
+
+        for (long long r0 = 0; r0 < n_; r0 += block_rows)
+        {
+            const int k = int(std::min<long long>(block_rows, n_ - r0));
+
+            if (row_major)
+            {
+                // the rows of the block are the columns of a p x k matrix
+                block = Eigen::Map<const Matrix>(x.data() + r0 * p, p, k);
+                add_block<true>(block, y + r0);
+                x.release(r0 * p, size_t(k) * p);
+            } else {
+                block.resize(k, p);
+                for (int j = 0; j < p; j++)
+                    block.col(j) = MapVec(x.data() + j * (long long)(n_) + r0, k);
+                add_block<false>(block, y + r0);
+                for (int j = 0; j < p; j++)
+                    x.release(j * (long long)(n_) + r0, k);
+            }
+        }
+    }
+
+    // column means of the rows so far
+    Array mean_x() const { return shift_x + sx / double(n); }
+
+    // the standardization of the rows so far, and the
+    // standardized X'X (lower triangle) and X'y
+    DataStd<double> standardized(Matrix &XX, Vector &XY) const
+    {
+        const double m = double(n);
+        const Array mx = sx / m;
+        const double my = sy / m;
+        const Array meanX = shift_x + mx;
+        const double meanY = shift_y + my;
+
+        // cross products about the means, and about zero
+        // without an intercept, since X and y are then not centred
+        XX = S;
+        XY = t;
+        XX.selfadjointView<Eigen::Lower>().rankUpdate(mx.matrix(), -m);
+        XY -= (m * my) * mx.matrix();
+
+        // the variances are always about the means, as in DataStd
+        DataStd<double> datstd(n, p, standardize, intercept);
+        datstd.set_centred_moments(meanX, XX.diagonal().array() / m, meanY, syy / m - my * my);
+
+        if (!intercept)
+        {
+            XX.selfadjointView<Eigen::Lower>().rankUpdate(meanX.matrix(), m);
+            XY += (m * meanY) * meanX.matrix();
+        }
+
+        Array scale(p);
+        for (int j = 0; j < p; j++)
+            scale[j] = datstd.get_scaleX(j);
+        const double scaleY = datstd.get_scaleY();
+
+        XX.triangularView<Eigen::StrictlyUpper>().setZero();
+        XX.array().colwise() /= scale;
+        XX.array().rowwise() /= scale.transpose();
+        XY = (XY.array() / (scale * scaleY)).matrix();
+
+        return datstd;
+    }
+};
+
+
+
+#endif // STREAMGRAM_H
@@ -0,0 +1,227 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <algorithm>
+#include "PerfCounters.h"
+
+// timings and a convergence trace for each lambda of a path of fits.
+// the solvers hold a pointer to it, NULL when nothing is recorded, and
+// only add to storage that is allocated by the constructor: the wall
+// time of the phases of the iterations, the changes of rho and the
+// refactorizations they cause, and a sample of the residuals and rho
+// every `every` iterations, of which the last `capacity` are kept in a
+// ring buffer, with the final iteration always last. with hardware
+// counters, the cycles, instructions and LLC misses of each phase are
+// added up in the same way as its time
+class SolverTelemetry
+{
+public:
+    enum Phase { SETUP = 0, FACTORIZE, X_UPDATE, Z_UPDATE, Y_UPDATE, CONVERGENCE, N_PHASES };
+    class Timer;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const int nlambda;
+    const int capacity;
+    const int every;
+    int current;                  // the lambda being fitted
+
+    double setup_time;            // construction of the solver, before the path
+    Eigen::ArrayXXd times;        // nlambda x N_PHASES seconds
+    Eigen::ArrayXi rho_changes;
+    Eigen::ArrayXi refactors;
+
+    // sample k of lambda i is row i * capacity + k % capacity
+    Eigen::ArrayXi trace_iter;
+    Eigen::ArrayXXd trace_val;    // resid_primal, resid_dual, rho
+    Eigen::ArrayXi trace_count;   // samples pushed for each lambda
+    int last_iter;                // iteration of the last sample of current
+    Timer *open;                  // the innermost running timer
+
+    const PerfCounters *counters; // NULL if the counters are not recorded
+    Eigen::ArrayXXd events;       // (lambda, phase) in row i * N_PHASES + phase, one column per event
+
+    void push(int iter, double resid_primal, double resid_dual, double rho)
+    {
+        const int row = current * capacity + trace_count[current] % capacity;
+        trace_iter[row] = iter;
+        trace_val(row, 0) = resid_primal;
+        trace_val(row, 1) = resid_dual;
+        trace_val(row, 2) = rho;
+        trace_count[current]++;
+        last_iter = iter;
+    }
+
+public:
+    // adds the wall time of its scope to a phase of the current lambda,
+    // and does nothing without a telemetry. the time of the timers opened
+    // inside the scope is only added to their own phases, e.g. the
+    // factorization in init() is not counted as setup
+    class Timer
+    {
+    private:
+        typedef PerfCounters::Event Event;
+
+        SolverTelemetry *telemetry;
+        const Phase phase;
+        Timer *outer;          // the timer open when this one started
+        double inner;          // seconds of the timers opened inside
+        double inner_events[PerfCounters::N_EVENTS];
+        double start_events[PerfCounters::N_EVENTS];
+        Clock::time_point start;
+
+    public:
+        Timer(SolverTelemetry *telemetry_, Phase phase_) :
+            telemetry(telemetry_), phase(phase_), outer(NULL), inner(0.0)
+        {
+            if (telemetry)
+            {
+                outer = telemetry->open;
+                telemetry->open = this;
+                if (telemetry->counters)
+                {
+                    std::fill(inner_events, inner_events + PerfCounters::N_EVENTS, 0.0);
+                    telemetry->counters->read(start_events);
+                }
+                start = Clock::now();
+            }
+        }
+
+        ~Timer()
+        {
+            if (telemetry)
+            {
+                const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                telemetry->times(telemetry->current, phase) += elapsed - inner;
+                if (outer)
+                    outer->inner += elapsed;
+
+                if (telemetry->counters)
+                {
+                    double counts[PerfCounters::N_EVENTS];
+                    telemetry->counters->read(counts);
+                    const int row = telemetry->current * N_PHASES + phase;
+                    for (int k = 0; k < PerfCounters::N_EVENTS; k++)
+                    {
+                        const double delta = counts[k] - start_events[k];
+                        telemetry->events(row, k) += delta - inner_events[k];
+                        if (outer)
+                            outer->inner_events[k] += delta;
+                    }
+                }
+                telemetry->open = outer;
+            }
+        }
+    };
+
+    // counters_ are read around each phase if not NULL, and stay
+    // owned by the caller
+    SolverTelemetry(int nlambda_, const PerfCounters *counters_ = NULL,
+                    int capacity_ = 64, int every_ = 10) :
+        nlambda(nlambda_), capacity(capacity_), every(every_),
+        current(0), setup_time(0.0),
+        times(Eigen::ArrayXXd::Zero(nlambda_, N_PHASES)),
+        rho_changes(Eigen::ArrayXi::Zero(nlambda_)),
+        refactors(Eigen::ArrayXi::Zero(nlambda_)),
+        trace_iter(nlambda_ * capacity_),
+        trace_val(nlambda_ * capacity_, 3),
+        trace_count(Eigen::ArrayXi::Zero(nlambda_)),
+        last_iter(-1), open(NULL),
+        counters(counters_),
+        events(Eigen::ArrayXXd::Zero(counters_ ? nlambda_ * N_PHASES : 0, PerfCounters::N_EVENTS))
+    {}
+
+    void add_setup(double seconds) { setup_time += seconds; }
+
+    // the following records belong to lambda i
+    void begin(int i)
+    {
+        current = i;
+        last_iter = -1;
+    }
+
+    void rho_changed() { rho_changes[current]++; }
+    void refactored() { refactors[current]++; }
+
+    // after iteration iter (from 0) of the current lambda
+    void sample(int iter, double resid_primal, double resid_dual, double rho)
+    {
+        if (iter % every == 0)
+            push(iter, resid_primal, resid_dual, rho);
+    }
+
+    // the last iteration of the current lambda, unless already sampled
+    void finish(int iter, double resid_primal, double resid_dual, double rho)
+    {
+        if (iter != last_iter)
+            push(iter, resid_primal, resid_dual, rho);
+    }
+
+    int get_nlambda() const { return nlambda; }
+    double get_setup() const { return setup_time; }
+    // nlambda x N_PHASES seconds
+    const Eigen::ArrayXXd &get_times() const { return times; }
+    const Eigen::ArrayXi &get_rho_changes() const { return rho_changes; }
+    const Eigen::ArrayXi &get_refactors() const { return refactors; }
+    // NULL if the counters are not recorded
+    const PerfCounters *get_counters() const { return counters; }
+
+    // the samples that are still in the ring buffers, in order: the
+    // lambda (from 0) and iteration of each, and its resid_primal,
+    // resid_dual and rho in the columns of val
+    void get_trace(Eigen::ArrayXi &lambda, Eigen::ArrayXi &iter, Eigen::ArrayXXd &val) const
+    {
+        int nsamples = 0;
+        for (int i = 0; i < nlambda; i++)
+            nsamples += std::min(trace_count[i], capacity);
+
+        lambda.resize(nsamples);
+        iter.resize(nsamples);
+        val.resize(nsamples, 3);
+        int k = 0;
+        for (int i = 0; i < nlambda; i++)
+        {
+            const int count = trace_count[i];
+            for (int s = std::max(0, count - capacity); s < count; s++, k++)
+            {
+                const int row = i * capacity + s % capacity;
+                lambda[k] = i;
+                iter[k] = trace_iter[row];
+                val.row(k) = trace_val.row(row);
+            }
+        }
+    }
+
+    // event k of the phases of each lambda
+    Eigen::MatrixXd event_matrix(int k) const
+    {
+        Eigen::MatrixXd res(nlambda, int(N_PHASES));
+        for (int i = 0; i < nlambda; i++)
+            for (int j = 0; j < N_PHASES; j++)
+                res(i, j) = events(i * N_PHASES + j, k);
+        return res;
+    }
+};
+
+
+// seconds since a point in time, for the setup outside the solvers
+class WallClock
+{
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    WallClock() : start(std::chrono::steady_clock::now()) {}
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+
+
+#endif // TELEMETRY_H
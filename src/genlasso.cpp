@@ -1,5 +1,7 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "ADMMGenLassoTall.h"
 //#include "ADMMGenLassoWide.h"
 #include "DataStd.h"
@@ -0,0 +1,187 @@
+#define EIGEN_DONT_PARALLELIZE
+
+#include "RcppBinding.h"
+
+
+#include "CoordGLM.h"
+#include "DataStd.h"
+
+using Eigen::MatrixXd;
+using Eigen::VectorXd;
+using Eigen::ArrayXd;
+
+using Rcpp::wrap;
+using Rcpp::as;
+using Rcpp::List;
+using Rcpp::Named;
+using Rcpp::IntegerVector;
+
+// fits the (gamma, lambda) grid for a penalty and family in CoordGLM.h,
+// in the format of fit_concave_grid() in mcp_coordinate_descent.cpp
+template<typename Penalty, typename Family>
+List fit_glm_grid(const MatrixXd &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                  ArrayXd &lambda, const ArrayXd &gamma, DataStd<double> &datstd,
+                  SEXP nlambda_, SEXP lmin_ratio_, bool intercept,
+                  int maxit, double tol, bool active_set, int irls_maxit,
+                  double irls_tol, int nthreads)
+{
+    typedef CoordGLM<Penalty, Family> Solver;
+    
+    const int n = datX.rows();
+    const int p = datX.cols();
+    const int ngamma = gamma.size();
+    int nlambda = lambda.size();
+    
+    Solver *solver;
+    solver = new Solver(datX, datY, penalty_factor, intercept, tol, active_set,
+                        irls_maxit, irls_tol);
+    
+    
+    
+    if (nlambda < 1) {
+        
+        double lmax = 0.0;
+        lmax = solver->get_lambda_zero() / n;
+        
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    // one solver per gamma, sharing the data
+    std::vector<Solver*> solvers(ngamma);
+    solvers[0] = solver;
+    for (int g = 1; g < ngamma; g++)
+        solvers[g] = new Solver(*solver);
+    
+    std::vector<MatrixXd> betas(ngamma, MatrixXd(p, nlambda));
+    std::vector<VectorXd> intercepts(ngamma, VectorXd(nlambda));
+    Eigen::MatrixXi niter(nlambda, ngamma);
+    
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic) if(ngamma > 1)
+    for (int g = 0; g < ngamma; g++) // loop over gamma values
+    {
+        solvers[g]->set_penalty(make_penalty<Penalty>(gamma[g]));
+        
+        for (int i = 0; i < nlambda; i++) // loop over lambda values
+        {
+            // -loglik / n + lambda * P(beta), times n
+            double ilambda = lambda[i] * n;
+            
+            if (i == 0)
+                solvers[g]->init(ilambda);
+            else
+                solvers[g]->init_warm(ilambda);
+            
+            niter(i, g) = solvers[g]->solve(maxit);
+            VectorXd res = solvers[g]->get_beta();
+            double beta0 = 0.0;
+            datstd.recover(beta0, res);
+            intercepts[g](i) = beta0 + solvers[g]->get_intercept();
+            betas[g].block(0, i, p, 1) = res;
+        }
+    }
+    
+    std::vector<IntegerVector> niters(ngamma);
+    List coef_results(ngamma);
+    
+    for (int g = 0; g < ngamma; g++)
+    {
+        niters[g] = IntegerVector(niter.col(g).data(), niter.col(g).data() + nlambda);
+        coef_results[g] = List::create(Named("beta") = betas[g],
+                                       Named("intercept") = intercepts[g],
+                                       Named("lambda") = lambda,
+                                       Named("gamma") = gamma[g]);
+    }
+    
+    for (int g = 1; g < ngamma; g++)
+        delete solvers[g];
+    delete solver;
+    
+    return List::create(Named("coefficients") = coef_results,
+                        Named("lambda") = lambda,
+                        Named("gamma") = gamma,
+                        Named("niter") = niters);
+}
+
+template<typename Family>
+List fit_glm_family(const std::string &penalty, const MatrixXd &datX, const VectorXd &datY,
+                    ArrayXd &penalty_factor, ArrayXd &lambda, const ArrayXd &gamma,
+                    DataStd<double> &datstd, SEXP nlambda_, SEXP lmin_ratio_, bool intercept,
+                    int maxit, double tol, bool active_set, int irls_maxit,
+                    double irls_tol, int nthreads)
+{
+    if (penalty == "lasso")
+        return fit_glm_grid<PenaltyL1, Family>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                               nlambda_, lmin_ratio_, intercept, maxit, tol,
+                                               active_set, irls_maxit, irls_tol, nthreads);
+    if (penalty == "SCAD")
+        return fit_glm_grid<PenaltySCAD, Family>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                                 nlambda_, lmin_ratio_, intercept, maxit, tol,
+                                                 active_set, irls_maxit, irls_tol, nthreads);
+    return fit_glm_grid<PenaltyMCP, Family>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                            nlambda_, lmin_ratio_, intercept, maxit, tol,
+                                            active_set, irls_maxit, irls_tol, nthreads);
+}
+
+// penalized binomial and Poisson regression by coordinate descent,
+// for cd.lasso() and cd.mcp(). gamma is ignored for the lasso
+RcppExport SEXP coord_glm(SEXP x_,
+                          SEXP y_,
+                          SEXP lambda_,
+                          SEXP gamma_,
+                          SEXP penalty_factor_,
+                          SEXP nlambda_,
+                          SEXP lmin_ratio_,
+                          SEXP standardize_,
+                          SEXP intercept_,
+                          SEXP opts_)
+{
+    BEGIN_RCPP
+    
+    Rcpp::NumericMatrix xx(x_);
+    Rcpp::NumericVector yy(y_);
+    
+    const int n = xx.rows();
+    const int p = xx.cols();
+    
+    MatrixXd datX(n, p);
+    VectorXd datY(n);
+    
+    std::copy(xx.begin(), xx.end(), datX.data());
+    std::copy(yy.begin(), yy.end(), datY.data());
+    
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    ArrayXd gamma(as<ArrayXd>(gamma_));
+    
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double tol       = as<double>(opts["tol"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const int irls_maxit   = as<int>(opts["irls_maxit"]);
+    const double irls_tol  = as<double>(opts["irls_tol"]);
+    const std::string penalty = as<std::string>(opts["penalty"]);
+    const std::string family  = as<std::string>(opts["family"]);
+    const bool standardize = as<bool>(standardize_);
+    const bool intercept   = as<bool>(intercept_);
+    
+    // the response is neither centred nor scaled
+    DataStd<double> datstd(n, p, standardize, intercept);
+    datstd.standardize_x(datX);
+    
+    if (family == "poisson")
+        return fit_glm_family<FamilyPoisson>(penalty, datX, datY, penalty_factor, lambda, gamma,
+                                             datstd, nlambda_, lmin_ratio_, intercept, maxit, tol,
+                                             active_set, irls_maxit, irls_tol, nthreads);
+    
+    return fit_glm_family<FamilyBinomial>(penalty, datX, datY, penalty_factor, lambda, gamma,
+                                          datstd, nlambda_, lmin_ratio_, intercept, maxit, tol,
+                                          active_set, irls_maxit, irls_tol, nthreads);
+    
+    END_RCPP
+}
@@ -1,5 +1,7 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "CoordLasso.h"
 #include "DataStd.h"
 
@@ -45,6 +47,9 @@ RcppExport SEXP coord_lasso(SEXP x_,
 {
     BEGIN_RCPP
     
+    // the time limit counts from here
+    const WallClock clock;
+    
     //Rcpp::NumericMatrix xx(x_);
     //Rcpp::NumericVector yy(y_);
     
@@ -88,6 +93,13 @@ RcppExport SEXP coord_lasso(SEXP x_,
     List opts(opts_);
     const int maxit        = as<int>(opts["maxit"]);
     const double tol       = as<double>(opts["tol"]);
+    const bool covariance  = as<bool>(opts["covariance"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const CoordOrder order = coord_order(as<std::string>(opts["order"]));
+    const int seed         = as<int>(opts["seed"]);
+    SolveDeadline deadline(as<double>(opts["time_limit"]), as<bool>(opts["interruptible"]),
+                           clock.seconds());
     const bool standardize = as<bool>(standardize_);
     const bool intercept   = as<bool>(intercept_);
     
@@ -95,7 +107,9 @@ RcppExport SEXP coord_lasso(SEXP x_,
     datstd.standardize(datX, datY);
     
     CoordLasso *solver;
-    solver = new CoordLasso(datX, datY, penalty_factor, tol);
+    solver = new CoordLasso(datX, datY, penalty_factor, tol, covariance, active_set, nthreads);
+    solver->set_order(order, seed);
+    solver->set_deadline(&deadline);
     
     
     
@@ -119,6 +133,8 @@ RcppExport SEXP coord_lasso(SEXP x_,
     MatrixXd beta(p+1, nlambda);
     
     IntegerVector niter(nlambda);
+    int nfit = nlambda;
+    List partial;
     double ilambda = 0.0;
     
     for(int i = 0; i < nlambda; i++)
@@ -134,6 +150,15 @@ RcppExport SEXP coord_lasso(SEXP x_,
         VectorXd res = solver->get_beta();
         double beta0 = 0.0;
         datstd.recover(beta0, res);
+        if (deadline.stopped())
+        {
+            // coordinate descent has no primal and dual residuals
+            VectorXd coef(p + 1);
+            coef << beta0, res;
+            partial = partial_fit(deadline, lambda[i], niter[i], NA_REAL, NA_REAL, coef);
+            nfit = i;
+            break;
+        }
         beta(0,i) = beta0;
         beta.block(1, i, p, 1) = res;
         //write_beta_matrix(beta, i, beta0, res);
@@ -144,9 +169,7 @@ RcppExport SEXP coord_lasso(SEXP x_,
     
     //beta.makeCompressed();
     
-    return List::create(Named("lambda") = lambda,
-                        Named("beta") = beta,
-                        Named("niter") = niter);
+    return path_result(lambda, beta, niter, NULL, nfit, partial);
     
     END_RCPP
 }
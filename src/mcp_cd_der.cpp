@@ -1,5 +1,7 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 
 #include "CoordMCPder.h"
 #include "DataStd.h"
@@ -93,6 +95,7 @@ RcppExport SEXP coord_mcp_der(SEXP x_,
     List opts(opts_);
     const int maxit        = as<int>(opts["maxit"]);
     const double tol       = as<double>(opts["tol"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
     const bool standardize = as<bool>(standardize_);
     const bool intercept   = as<bool>(intercept_);
     
@@ -109,7 +112,7 @@ RcppExport SEXP coord_mcp_der(SEXP x_,
     datstd.standardize(datX, datY);
     
     CoordMCPder *solver;
-    solver = new CoordMCPder(datX, datY, penalty_factor, num_loss, tol);
+    solver = new CoordMCPder(datX, datY, penalty_factor, num_loss, tol, active_set);
     
     
     
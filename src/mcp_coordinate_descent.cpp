@@ -1,7 +1,11 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 
 #include "CoordMCP.h"
+#include "CoordCV.h"
+#include "CoordPrepared.h"
 #include "DataStd.h"
 //#include <boost/tuple/tuple.hpp>
 
@@ -35,6 +39,150 @@ inline void write_beta_matrix(SpMat &betas, int col, double beta0, SpVec &coef)
     }
 }
 
+// fits the (gamma, lambda) grid from a solver for the first gamma,
+// which is copied for the other gammas and deleted on return
+template<typename Solver>
+List fit_concave_solvers(Solver *solver, int n, int p,
+                         ArrayXd &lambda, const ArrayXd &gamma, DataStd<double> &datstd,
+                         SEXP nlambda_, SEXP lmin_ratio_,
+                         int maxit, int nthreads, bool warm_gamma)
+{
+    const int ngamma = gamma.size();
+    int nlambda = lambda.size();
+    
+    if (nlambda < 1) {
+        
+        double lmax = 0.0;
+        lmax = solver->get_lambda_zero() / n * datstd.get_scaleY();
+        
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    
+    
+    
+    //SpMat beta(p + 1, nlambda);
+    //beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    
+    // one solver per gamma. the solvers only map the data, and in
+    // covariance mode the columns of X'X come from a cache shared by
+    // the copies (CoordPenalized::share_gram), so a copy only
+    // duplicates O(n + p) state
+    std::vector<Solver*> solvers(ngamma);
+    solvers[0] = solver;
+    for (int g = 1; g < ngamma; g++)
+        solvers[g] = new Solver(*solver);
+    
+    std::vector<MatrixXd> betas(ngamma, MatrixXd(p, nlambda));
+    std::vector<VectorXd> intercepts(ngamma, VectorXd(nlambda));
+    Eigen::MatrixXi niter(nlambda, ngamma);
+    
+    // with warm_gamma, fit (g, i) may also start from the fit for the
+    // previous gamma at the same lambda, so the grid is processed along its
+    // anti-diagonals d = g + i, whose fits are independent of each other.
+    // the standardized solutions of the previous diagonal are kept in
+    // a double buffer. otherwise each gamma is an independent path
+    std::vector<VectorXd> diag_beta[2];
+    diag_beta[0].resize(ngamma);
+    diag_beta[1].resize(ngamma);
+    
+    const int nsteps = warm_gamma ? (ngamma + nlambda - 1) : 1;
+    
+    // with a single gamma the loop is serial and the threads, if any,
+    // are those of the solver's sweeps, not nested within this loop
+    for (int d = 0; d < nsteps; d++)
+    {
+        #pragma omp parallel for num_threads(nthreads) schedule(dynamic) if(ngamma > 1)
+        for (int g = 0; g < ngamma; g++) // loop over gamma values
+        {
+            int ifirst = 0, ilast = nlambda - 1;
+            if (warm_gamma)
+            {
+                ifirst = ilast = d - g;
+                if (ifirst < 0 || ifirst >= nlambda)
+                    continue;
+            }
+            
+            for (int i = ifirst; i <= ilast; i++) // loop over lambda values
+            {
+                double ilambda = lambda[i] * n / datstd.get_scaleY();
+                
+                if (i == 0)
+                    solvers[g]->init(ilambda, gamma[g]);
+                
+                if (warm_gamma && g > 0)
+                    solvers[g]->init_warm(ilambda, gamma[g], diag_beta[(d + 1) % 2][g - 1]);
+                else if (i > 0)
+                    solvers[g]->init_warm(ilambda, gamma[g]);
+                
+                niter(i, g) = solvers[g]->solve(maxit);
+                VectorXd res = solvers[g]->get_beta();
+                if (warm_gamma)
+                    diag_beta[d % 2][g] = res;
+                double beta0 = 0.0;
+                datstd.recover(beta0, res);
+                intercepts[g](i) = beta0;
+                betas[g].block(0, i, p, 1) = res;
+            }
+        }
+    }
+    
+    std::vector<IntegerVector> niters(ngamma);
+    
+    //std::vector<boost::tuple<MatrixXd, VectorXd, ArrayXd, double> > coef_results(ngamma);
+    List coef_results(ngamma);
+    
+    for (int g = 0; g < ngamma; g++)
+    {
+        niters[g] = IntegerVector(niter.col(g).data(), niter.col(g).data() + nlambda);
+        
+        //coef_results[g] = boost::make_tuple(beta, intercepts, lambda, gamma[g]);
+        coef_results[g] = List::create(Named("beta") = betas[g], 
+                                       Named("intercept") = intercepts[g], 
+                                       Named("lambda") = lambda, 
+                                       Named("gamma") = gamma[g]);
+    }
+    
+    for (int g = 1; g < ngamma; g++)
+        delete solvers[g];
+    delete solver;
+    
+    //beta.makeCompressed();
+    
+    
+    return List::create(Named("coefficients") = coef_results,
+                        Named("lambda") = lambda,
+                        Named("gamma") = gamma,
+                        Named("niter") = niters);
+}
+
+// fits the (gamma, lambda) grid for one of the penalties in CoordMCP.h
+template<typename Solver>
+List fit_concave_grid(const MatrixXd &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                      ArrayXd &lambda, const ArrayXd &gamma, DataStd<double> &datstd,
+                      SEXP nlambda_, SEXP lmin_ratio_,
+                      int maxit, double tol, bool covariance, bool active_set,
+                      int nthreads, bool warm_gamma, CoordOrder order, int seed)
+{
+    // with several gamma values the threads are used across gammas,
+    // otherwise within the coordinate descent sweeps
+    Solver *solver;
+    solver = new Solver(datX, datY, penalty_factor, tol, covariance, active_set,
+                        (gamma.size() > 1) ? 1 : nthreads);
+    solver->set_order(order, seed);
+    
+    // the X'X columns of covariance mode, computed once for all gammas
+    FullGram gram(datX);
+    if (gamma.size() > 1)
+        solver->share_gram(&gram);
+    
+    return fit_concave_solvers(solver, datX.rows(), datX.cols(), lambda, gamma, datstd,
+                               nlambda_, lmin_ratio_, maxit, nthreads, warm_gamma);
+}
+
 RcppExport SEXP coord_mcp(SEXP x_, 
                           SEXP y_, 
                           SEXP lambda_,
@@ -83,9 +231,7 @@ RcppExport SEXP coord_mcp(SEXP x_,
     // which is equivalent to minimizing
     //   1/2 * ||y - X * beta||^2 + n * lambda * ||beta||_1
     ArrayXd lambda(as<ArrayXd>(lambda_));
-    int nlambda = lambda.size();
     ArrayXd gamma(as<ArrayXd>(gamma_));
-    int ngamma = gamma.size();
     
     ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
     
@@ -93,84 +239,231 @@ RcppExport SEXP coord_mcp(SEXP x_,
     List opts(opts_);
     const int maxit        = as<int>(opts["maxit"]);
     const double tol       = as<double>(opts["tol"]);
+    const bool covariance  = as<bool>(opts["covariance"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const bool warm_gamma  = as<bool>(opts["warm_gamma"]);
+    const std::string penalty = as<std::string>(opts["penalty"]);
+    const CoordOrder order = coord_order(as<std::string>(opts["order"]));
+    const int seed         = as<int>(opts["seed"]);
     const bool standardize = as<bool>(standardize_);
     const bool intercept   = as<bool>(intercept_);
     
     DataStd<double> datstd(n, p, standardize, intercept);
     datstd.standardize(datX, datY);
     
-    CoordMCP *solver;
-    solver = new CoordMCP(datX, datY, penalty_factor, tol);
+    if (penalty == "SCAD")
+        return fit_concave_grid<CoordSCAD>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                           nlambda_, lmin_ratio_, maxit, tol, covariance,
+                                           active_set, nthreads, warm_gamma, order, seed);
     
+    return fit_concave_grid<CoordMCP>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                      nlambda_, lmin_ratio_, maxit, tol, covariance,
+                                      active_set, nthreads, warm_gamma, order, seed);
     
+    END_RCPP
+}
+
+
+// coord_mcp for a design prepared by prepare_design(), with the
+// standardization chosen there. the fits always use covariance
+// updates, with the columns of X'X cached in the design
+RcppExport SEXP coord_mcp_prepared(SEXP design_, 
+                                   SEXP y_, 
+                                   SEXP lambda_,
+                                   SEXP gamma_,
+                                   SEXP penalty_factor_,
+                                   SEXP nlambda_, 
+                                   SEXP lmin_ratio_,
+                                   SEXP opts_)
+{
+    BEGIN_RCPP
     
-    if (nlambda < 1) {
-        
-        double lmax = 0.0;
-        lmax = solver->get_lambda_zero() / n * datstd.get_scaleY();
-        
-        double lmin = as<double>(lmin_ratio_) * lmax;
-        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
-        lambda = lambda.exp();
-        nlambda = lambda.size();
-    }
+    Rcpp::XPtr<PreparedDesign> design(design_);
+    Rcpp::NumericVector yy(y_);
     
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    ArrayXd gamma(as<ArrayXd>(gamma_));
     
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
     
     
-    //SpMat beta(p + 1, nlambda);
-    //beta.reserve(Eigen::VectorXi::Constant(nlambda, std::min(n, p)));
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double tol       = as<double>(opts["tol"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const bool warm_gamma  = as<bool>(opts["warm_gamma"]);
+    const std::string penalty = as<std::string>(opts["penalty"]);
+    const CoordOrder order = coord_order(as<std::string>(opts["order"]));
+    const int seed         = as<int>(opts["seed"]);
     
-    std::vector<IntegerVector> niters(ngamma);
+    VectorXd datY;
+    DataStd<double> datstd = design->standardize_response(yy.begin(), datY);
     
-    //std::vector<boost::tuple<MatrixXd, VectorXd, ArrayXd, double> > coef_results(ngamma);
-    List coef_results(ngamma);
+    if (penalty == "SCAD")
+    {
+        CoordConcavePrepared<PenaltySCAD> *solver =
+            new CoordConcavePrepared<PenaltySCAD>(*design, datY, penalty_factor, tol, active_set);
+        solver->set_order(order, seed);
+        return fit_concave_solvers(solver, design->n, design->p, lambda, gamma, datstd,
+                                   nlambda_, lmin_ratio_, maxit, nthreads, warm_gamma);
+    }
+    
+    CoordConcavePrepared<PenaltyMCP> *solver =
+        new CoordConcavePrepared<PenaltyMCP>(*design, datY, penalty_factor, tol, active_set);
+    solver->set_order(order, seed);
+    return fit_concave_solvers(solver, design->n, design->p, lambda, gamma, datstd,
+                               nlambda_, lmin_ratio_, maxit, nthreads, warm_gamma);
     
-    double ilambda = 0.0;
+    END_RCPP
+}
+
+// out-of-fold predictions for each (fold, gamma) pair. the training
+// solvers of a fold share its standardized statistics and X'X columns
+template<typename Penalty>
+void cv_concave_grid(std::vector<CVFold*> &folds, const std::vector<int> &fold_start,
+                     ArrayXd &penalty_factor, const ArrayXd &lambda, const ArrayXd &gamma,
+                     std::vector<MatrixXd> &preds, int maxit, double tol,
+                     bool active_set, int nthreads, bool warm_gamma,
+                     CoordOrder order, int seed)
+{
+    const int nfolds = folds.size();
+    const int ngamma = gamma.size();
+    const int nlambda = lambda.size();
     
+    // with warm_gamma the fits for gamma g start from those for
+    // gamma g - 1 in the same fold, so a task is a fold
+    const int ntasks = warm_gamma ? nfolds : nfolds * ngamma;
     
-    for (int g = 0; g < ngamma; g++) // loop over gamma values
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic)
+    for (int t = 0; t < ntasks; t++)
     {
-        MatrixXd beta(p, nlambda);
-        VectorXd intercepts(nlambda);
-        IntegerVector niter(nlambda);
-        for(int i = 0; i < nlambda; i++) // loop over lambda values
+        const int k = warm_gamma ? t : t / ngamma;
+        const int gfirst = warm_gamma ? 0 : t % ngamma;
+        const int glast  = warm_gamma ? ngamma - 1 : gfirst;
+        CVFold &fold = *folds[k];
+        
+        std::vector<VectorXd> beta_prev_gamma(nlambda);
+        
+        for (int g = gfirst; g <= glast; g++)
         {
-            ilambda = lambda[i] * n / datstd.get_scaleY();
-            
-            if(i == 0)
-                solver->init(ilambda, gamma[g]);
-            else
-                solver->init_warm(ilambda, gamma[g]);
-            
-            niter[i] = solver->solve(maxit);
-            VectorXd res = solver->get_beta();
-            double beta0 = 0.0;
-            datstd.recover(beta0, res);
-            intercepts(i) = beta0;
-            beta.block(0, i, p, 1) = res;
-            //write_beta_matrix(beta, i, beta0, res);
+            CoordConcaveCV<Penalty> solver(fold, penalty_factor, tol, active_set);
+            solver.set_order(order, seed);
             
+            for (int i = 0; i < nlambda; i++)
+            {
+                double ilambda = lambda[i] * fold.nobs / fold.datstd.get_scaleY();
+                
+                if (i == 0)
+                    solver.init(ilambda, gamma[g]);
+                
+                if (warm_gamma && g > 0)
+                    solver.init_warm(ilambda, gamma[g], beta_prev_gamma[i]);
+                else if (i > 0)
+                    solver.init_warm(ilambda, gamma[g]);
+                
+                solver.solve(maxit);
+                VectorXd res = solver.get_beta();
+                if (warm_gamma)
+                    beta_prev_gamma[i] = res;
+                double beta0 = 0.0;
+                fold.datstd.recover(beta0, res);
+                fold.predict(res, beta0, &preds[g](fold_start[k], i));
+            }
         }
-        niters[g]       = niter;
-        
-        //coef_results[g] = boost::make_tuple(beta, intercepts, lambda, gamma[g]);
-        coef_results[g] = List::create(Named("beta") = beta, 
-                                       Named("intercept") = intercepts, 
-                                       Named("lambda") = lambda, 
-                                       Named("gamma") = gamma[g]);
     }
+}
+
+// K-fold cross-validation for coord_mcp. foldid holds the fold
+// (1, ..., nfolds) of each row. the rows are copied once in fold
+// order and the training statistics of each fold are obtained by
+// subtracting those of its held-out rows, so no per-fold copies of
+// X are made and X'X is computed at most once for all folds.
+// returns the out-of-fold predictions, one N x nlambda matrix per gamma
+RcppExport SEXP cv_coord_mcp(SEXP x_, 
+                             SEXP y_, 
+                             SEXP lambda_,
+                             SEXP gamma_,
+                             SEXP penalty_factor_,
+                             SEXP foldid_,
+                             SEXP standardize_, 
+                             SEXP intercept_,
+                             SEXP opts_)
+{
+    BEGIN_RCPP
     
-    delete solver;
+    Rcpp::NumericMatrix xx(x_);
+    Rcpp::NumericVector yy(y_);
+    IntegerVector foldid(foldid_);
     
-    //beta.makeCompressed();
+    const int n = xx.rows();
+    const int p = xx.cols();
     
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    ArrayXd gamma(as<ArrayXd>(gamma_));
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
     
-    return List::create(Named("coefficients") = coef_results,
-                        Named("lambda") = lambda,
-                        Named("gamma") = gamma,
-                        Named("niter") = niters);
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double tol       = as<double>(opts["tol"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const bool warm_gamma  = as<bool>(opts["warm_gamma"]);
+    const std::string penalty = as<std::string>(opts["penalty"]);
+    const CoordOrder order = coord_order(as<std::string>(opts["order"]));
+    const int seed         = as<int>(opts["seed"]);
+    const bool standardize = as<bool>(standardize_);
+    const bool intercept   = as<bool>(intercept_);
+    
+    // order the rows by fold, so that the held-out rows
+    // of each fold are a contiguous block
+    std::vector<int> row_order, fold_start;
+    const int nfolds = fold_order(foldid.begin(), n, row_order, fold_start);
+    
+    MatrixXd datX(n, p);
+    VectorXd datY(n);
+    for (int j = 0; j < p; j++)
+    {
+        const double *xcol = &xx[j * n];
+        for (int i = 0; i < n; i++)
+            datX(i, j) = xcol[row_order[i]];
+    }
+    for (int i = 0; i < n; i++)
+        datY(i) = yy[row_order[i]];
+    
+    FullGram gram(datX);
+    std::vector<CVFold*> folds;
+    make_folds(datX, datY, &gram, fold_start, standardize, intercept, folds);
+    
+    std::vector<MatrixXd> preds(gamma.size(), MatrixXd(n, lambda.size()));
+    
+    if (penalty == "SCAD")
+        cv_concave_grid<PenaltySCAD>(folds, fold_start, penalty_factor, lambda, gamma, preds,
+                                     maxit, tol, active_set, nthreads, warm_gamma,
+                                     order, seed);
+    else
+        cv_concave_grid<PenaltyMCP>(folds, fold_start, penalty_factor, lambda, gamma, preds,
+                                    maxit, tol, active_set, nthreads, warm_gamma,
+                                    order, seed);
+    
+    for (int k = 0; k < nfolds; k++)
+        delete folds[k];
+    
+    // back to the original row order
+    List pred_results(gamma.size());
+    for (int g = 0; g < gamma.size(); g++)
+    {
+        Rcpp::NumericMatrix pred(n, lambda.size());
+        for (int i = 0; i < lambda.size(); i++)
+        {
+            for (int r = 0; r < n; r++)
+                pred(row_order[r], i) = preds[g](r, i);
+        }
+        pred_results[g] = pred;
+    }
+    
+    return pred_results;
     
     END_RCPP
 }
-
@@ -2,6 +2,8 @@
 
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "ADMMogLassoTall.h"
 #include "ADMMogLassoLogisticTall.h"
 //#include "ADMMogLassoWide.h"
@@ -106,9 +108,9 @@ RcppExport SEXP admm_oglasso_dense(SEXP x_,
     bool intercept_bin = intercept;
     
     const SpMat group(as<MSpMat>(group_));
-    CharacterVector family(as<CharacterVector>(family_));
+    const std::string family(as<std::string>(family_));
     const MapVec group_weights(as<MapVec>(group_weights_));
-    IntegerVector group_idx(group_idx_);
+    const VectorXi group_idx(as<VectorXi>(group_idx_));
     
     const int ngroups(as<int>(ngroups_));
     
@@ -116,7 +118,7 @@ RcppExport SEXP admm_oglasso_dense(SEXP x_,
     // fit intercept the dumb way if it is wanted
     bool fullbetamat = false;
     int add = 0;
-    if (family(0) != "gaussian")
+    if (family != "gaussian")
     {
         standardize = false;
         intercept = false;
@@ -161,13 +163,13 @@ RcppExport SEXP admm_oglasso_dense(SEXP x_,
     if(n > 2 * p)
     {
         
-        if (family(0) == "gaussian")
+        if (family == "gaussian")
         {
             solver_tall = new ADMMogLassoTall(datX, datY, C, n, p, M, ngroups, 
                                               family, group_weights, group_idx, 
                                               dynamic_rho, irls_tol, irls_maxit, 
                                               eps_abs, eps_rel);
-        } else if (family(0) == "binomial")
+        } else if (family == "binomial")
         {
             solver_tall = new ADMMogLassoLogisticTall(datX, datY, C, n, p + add, M, ngroups, 
                                                       family, group_weights, group_idx, 
@@ -178,13 +180,13 @@ RcppExport SEXP admm_oglasso_dense(SEXP x_,
     else
     {
         /*
-        if (family(0) == "gaussian")
+        if (family == "gaussian")
         {
             solver_wide = new ADMMogLassoTallWide(datX, datY, C, n, p, M, ngroups, 
                                               family, group_weights, group_idx, 
                                               dynamic_rho, irls_tol, irls_maxit, 
                                               eps_abs, eps_rel);
-        } else if (family(0) == "binomial")
+        } else if (family == "binomial")
         {
             solver_wide = new ADMMogLassoLogisticWide(datX, datY, C, n, p, M, ngroups, 
                                                       family, group_weights, group_idx, 
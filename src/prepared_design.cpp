@@ -0,0 +1,27 @@
+#define EIGEN_DONT_PARALLELIZE
+
+#include "RcppBinding.h"
+
+#include "PreparedDesign.h"
+
+using Rcpp::as;
+
+// standardizes a copy of x once and returns it as an external pointer
+// for admm_lasso_prepared() and coord_mcp_prepared(). the derived
+// quantities are computed by the first fit that needs them, and the
+// design is freed when the pointer is garbage collected
+RcppExport SEXP prepare_design(SEXP x_, 
+                               SEXP standardize_, 
+                               SEXP intercept_)
+{
+BEGIN_RCPP
+    
+    Rcpp::NumericMatrix xx(x_);
+    
+    PreparedDesign *design = new PreparedDesign(xx.begin(), xx.rows(), xx.cols(),
+                                                as<bool>(standardize_), as<bool>(intercept_));
+    
+    return Rcpp::XPtr<PreparedDesign>(design, true);
+    
+END_RCPP
+}
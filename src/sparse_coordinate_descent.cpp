@@ -0,0 +1,181 @@
+#define EIGEN_DONT_PARALLELIZE
+
+#include "RcppBinding.h"
+
+
+#include "CoordSparse.h"
+#include "DataStd.h"
+
+using Eigen::MatrixXd;
+using Eigen::VectorXd;
+using Eigen::ArrayXd;
+
+using Rcpp::wrap;
+using Rcpp::as;
+using Rcpp::List;
+using Rcpp::Named;
+using Rcpp::IntegerVector;
+
+typedef Eigen::MappedSparseMatrix<double> MSpMat;
+
+// fits the (gamma, lambda) grid for a sparse design, in the format
+// of fit_concave_grid() in mcp_coordinate_descent.cpp
+template<typename Penalty>
+List fit_sparse_grid(const MSpMat &datX, const VectorXd &datY, ArrayXd &penalty_factor,
+                     ArrayXd &lambda, const ArrayXd &gamma, DataStd<double> &datstd,
+                     SEXP nlambda_, SEXP lmin_ratio_,
+                     int maxit, double tol, bool active_set, int nthreads)
+{
+    typedef CoordSparse<Penalty> Solver;
+    
+    const int n = datX.rows();
+    const int p = datX.cols();
+    const int ngamma = gamma.size();
+    int nlambda = lambda.size();
+    
+    ArrayXd center(p), scale(p);
+    for (int j = 0; j < p; j++)
+    {
+        center[j] = datstd.get_meanX(j);
+        scale[j] = datstd.get_scaleX(j);
+    }
+    
+    Solver *solver;
+    solver = new Solver(datX, datY, center, scale, penalty_factor, tol, active_set);
+    
+    
+    
+    if (nlambda < 1) {
+        
+        double lmax = 0.0;
+        lmax = solver->get_lambda_zero() / n * datstd.get_scaleY();
+        
+        double lmin = as<double>(lmin_ratio_) * lmax;
+        lambda.setLinSpaced(as<int>(nlambda_), std::log(lmax), std::log(lmin));
+        lambda = lambda.exp();
+        nlambda = lambda.size();
+    }
+    
+    // one solver per gamma. the solvers only point to the nonzeros
+    // of X, so copies only duplicate O(n + p) state
+    std::vector<Solver*> solvers(ngamma);
+    solvers[0] = solver;
+    for (int g = 1; g < ngamma; g++)
+        solvers[g] = new Solver(*solver);
+    
+    std::vector<MatrixXd> betas(ngamma, MatrixXd(p, nlambda));
+    std::vector<VectorXd> intercepts(ngamma, VectorXd(nlambda));
+    Eigen::MatrixXi niter(nlambda, ngamma);
+    
+    #pragma omp parallel for num_threads(nthreads) schedule(dynamic) if(ngamma > 1)
+    for (int g = 0; g < ngamma; g++) // loop over gamma values
+    {
+        solvers[g]->set_penalty(make_penalty<Penalty>(gamma[g]));
+        
+        for (int i = 0; i < nlambda; i++) // loop over lambda values
+        {
+            double ilambda = lambda[i] * n / datstd.get_scaleY();
+            
+            if (i == 0)
+                solvers[g]->init(ilambda);
+            else
+                solvers[g]->init_warm(ilambda);
+            
+            niter(i, g) = solvers[g]->solve(maxit);
+            VectorXd res = solvers[g]->get_beta();
+            double beta0 = 0.0;
+            datstd.recover(beta0, res);
+            intercepts[g](i) = beta0;
+            betas[g].block(0, i, p, 1) = res;
+        }
+    }
+    
+    std::vector<IntegerVector> niters(ngamma);
+    List coef_results(ngamma);
+    
+    for (int g = 0; g < ngamma; g++)
+    {
+        niters[g] = IntegerVector(niter.col(g).data(), niter.col(g).data() + nlambda);
+        coef_results[g] = List::create(Named("beta") = betas[g],
+                                       Named("intercept") = intercepts[g],
+                                       Named("lambda") = lambda,
+                                       Named("gamma") = gamma[g]);
+    }
+    
+    for (int g = 1; g < ngamma; g++)
+        delete solvers[g];
+    delete solver;
+    
+    return List::create(Named("coefficients") = coef_results,
+                        Named("lambda") = lambda,
+                        Named("gamma") = gamma,
+                        Named("niter") = niters);
+}
+
+// coordinate descent for a dgCMatrix x, for cd.lasso() and cd.mcp().
+// x is neither copied nor densified, standardization is implicit
+// (see CoordSparse.h). gamma is ignored for the lasso
+RcppExport SEXP coord_sparse(SEXP x_,
+                             SEXP y_,
+                             SEXP lambda_,
+                             SEXP gamma_,
+                             SEXP penalty_factor_,
+                             SEXP nlambda_,
+                             SEXP lmin_ratio_,
+                             SEXP standardize_,
+                             SEXP intercept_,
+                             SEXP opts_)
+{
+    BEGIN_RCPP
+    
+    const MSpMat datX(as<MSpMat>(x_));
+    VectorXd datY(as<VectorXd>(y_));
+    
+    const int n = datX.rows();
+    const int p = datX.cols();
+    
+    ArrayXd lambda(as<ArrayXd>(lambda_));
+    ArrayXd gamma(as<ArrayXd>(gamma_));
+    
+    ArrayXd penalty_factor(as<ArrayXd>(penalty_factor_));
+    
+    
+    List opts(opts_);
+    const int maxit        = as<int>(opts["maxit"]);
+    const double tol       = as<double>(opts["tol"]);
+    const bool active_set  = as<bool>(opts["active_set"]);
+    const int nthreads     = as<int>(opts["nthreads"]);
+    const std::string penalty = as<std::string>(opts["penalty"]);
+    const bool standardize = as<bool>(standardize_);
+    const bool intercept   = as<bool>(intercept_);
+    
+    // the moments of the columns from their nonzeros
+    ArrayXd sx(p), sxx(p);
+    for (int j = 0; j < p; j++)
+    {
+        double s = 0, ss = 0;
+        for (MSpMat::InnerIterator it(datX, j); it; ++it)
+        {
+            s += it.value();
+            ss += it.value() * it.value();
+        }
+        sx[j] = s;
+        sxx[j] = ss;
+    }
+    
+    DataStd<double> datstd(n, p, standardize, intercept);
+    datstd.set_moments(sx, sxx, datY.sum(), datY.squaredNorm());
+    datY.array() -= datstd.get_meanY();
+    datY.array() /= datstd.get_scaleY();
+    
+    if (penalty == "lasso")
+        return fit_sparse_grid<PenaltyL1>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                          nlambda_, lmin_ratio_, maxit, tol, active_set, nthreads);
+    if (penalty == "SCAD")
+        return fit_sparse_grid<PenaltySCAD>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                            nlambda_, lmin_ratio_, maxit, tol, active_set, nthreads);
+    return fit_sparse_grid<PenaltyMCP>(datX, datY, penalty_factor, lambda, gamma, datstd,
+                                       nlambda_, lmin_ratio_, maxit, tol, active_set, nthreads);
+    
+    END_RCPP
+}
@@ -1,5 +1,7 @@
 #define EIGEN_DONT_PARALLELIZE
 
+#include "RcppBinding.h"
+
 #include "ADMMSparseGenridgeTall.h"
 #include "ADMMLassoWide.h"
 #include "DataStd.h"
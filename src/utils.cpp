@@ -1,6 +1,7 @@
 
 
 #include "utils.h"
+#include "Linalg/Gram.h"
 
 double threshold(double num) 
 {
@@ -55,11 +56,16 @@ MatrixXd XWXt(const MatrixXd& xx, const MatrixXd& ww) {
   return (AWAt);
 }
 
-//computes X'X
+//computes X'X, in blocks on all the threads
 MatrixXd XtX(const MatrixXd& xx) {
-  const int n(xx.cols());
-  MatrixXd AtA(MatrixXd(n, n).setZero().
-    selfadjointView<Lower>().rankUpdate(xx.adjoint()));
+  MatrixXd AtA;
+#ifdef _OPENMP
+  Linalg::gram_lower(AtA, xx, omp_get_max_threads());
+#else
+  Linalg::gram_lower(AtA, xx, 1);
+#endif
+  // gram_lower() only fills the lower triangle
+  AtA.triangularView<Eigen::StrictlyUpper>() = AtA.transpose();
   return (AtA);
 }
 
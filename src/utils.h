@@ -2,8 +2,8 @@
 #define _oem2_UTILS_H
 
 
-#include <Rcpp.h>
-#include <RcppEigen.h>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
 #include <vector> 
 #include <functional> 
 #include <algorithm> 